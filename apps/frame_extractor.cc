@@ -0,0 +1,179 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Extracts the frames of a recorded capture with frame_extractor and
+ * writes them to a file, in capture order. Each frame is a record of
+ * - the position where its sync word ended, as a uint64_t
+ * - its virtual channel, as a uint32_t
+ * - the length of its payload in bytes, as a uint32_t
+ * - the payload, hard bytes or soft values as in the capture
+ * all in host byte order.
+ */
+
+#include "frame_extractor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using gr::tutorial::frame_extractor;
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] capture output\n"
+            "  -p byte   preamble byte in hex (default 33)\n"
+            "  -l n      preamble length in bytes (default 8)\n"
+            "  -s hex    sync words in hex, one after the other (default 1acffc1d)\n"
+            "  -n n      number of sync words (default 1)\n"
+            "  -m n      modulation, 0 BPSK, 1 QPSK, 2 8PSK (default 0)\n"
+            "  -f n      capture format, 0 unpacked, 1 packed, 2 float, 3 int8 (default 0)\n"
+            "  -d        differential encoding\n"
+            "  -a rate   false alarm rate, 0 for fixed thresholds (default 0)\n"
+            "  -H n      header format (default 0)\n"
+            "  -c n      frame contexts (default 1)\n"
+            "  -t n      threads, 0 for all the cores (default 0)\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+static std::vector<uint8_t>
+parse_hex(const char *s)
+{
+    std::vector<uint8_t> v;
+    size_t n = strlen(s);
+    if(n == 0 || n % 2){
+        throw std::invalid_argument("frame_extractor: Invalid hex string");
+    }
+    for(size_t i = 0; i < n; i += 2){
+        char b[3] = {s[i], s[i + 1], 0};
+        char *end;
+        v.push_back(strtoul(b, &end, 16));
+        if(*end){
+            throw std::invalid_argument("frame_extractor: Invalid hex string");
+        }
+    }
+    return v;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint8_t preamble = 0x33;
+    uint8_t preamble_len = 8;
+    std::vector<uint8_t> sync_word = {0x1a, 0xcf, 0xfc, 0x1d};
+    size_t nsync_words = 1;
+    int mod = 0;
+    int format = 0;
+    bool differential = false;
+    double false_alarm_rate = 0.0;
+    int header = 0;
+    int contexts = 1;
+    int threads = 0;
+
+    int opt;
+    try{
+        while((opt = getopt(argc, argv, "p:l:s:n:m:f:da:H:c:t:")) != -1){
+            switch(opt){
+                case 'p':
+                    preamble = strtoul(optarg, nullptr, 16);
+                    break;
+                case 'l':
+                    preamble_len = atoi(optarg);
+                    break;
+                case 's':
+                    sync_word = parse_hex(optarg);
+                    break;
+                case 'n':
+                    nsync_words = atoi(optarg);
+                    break;
+                case 'm':
+                    mod = atoi(optarg);
+                    break;
+                case 'f':
+                    format = atoi(optarg);
+                    break;
+                case 'd':
+                    differential = true;
+                    break;
+                case 'a':
+                    false_alarm_rate = atof(optarg);
+                    break;
+                case 'H':
+                    header = atoi(optarg);
+                    break;
+                case 'c':
+                    contexts = atoi(optarg);
+                    break;
+                case 't':
+                    threads = atoi(optarg);
+                    break;
+                default:
+                    usage(argv[0]);
+            }
+        }
+        if(argc - optind != 2){
+            usage(argv[0]);
+        }
+
+        frame_extractor ex(preamble, preamble_len, sync_word, mod, format,
+                           differential, false_alarm_rate, header, contexts,
+                           nsync_words, threads);
+        std::vector<frame_extractor::frame> frames = ex.extract(std::string(argv[optind]));
+
+        FILE *out = fopen(argv[optind + 1], "wb");
+        if(!out){
+            perror(argv[optind + 1]);
+            return EXIT_FAILURE;
+        }
+        const pmt::pmt_t vcid_key = pmt::mp("vcid");
+        for(const frame_extractor::frame &f : frames){
+            uint32_t vcid = pmt::to_uint64(pmt::dict_ref(pmt::car(f.pdu), vcid_key,
+                                                         pmt::from_uint64(0)));
+            size_t len;
+            const void *data = pmt::uniform_vector_elements(pmt::cdr(f.pdu), len);
+            uint32_t nbytes = len;
+            if(fwrite(&f.offset, sizeof(f.offset), 1, out) != 1
+               || fwrite(&vcid, sizeof(vcid), 1, out) != 1
+               || fwrite(&nbytes, sizeof(nbytes), 1, out) != 1
+               || fwrite(data, 1, len, out) != len){
+                perror(argv[optind + 1]);
+                fclose(out);
+                return EXIT_FAILURE;
+            }
+        }
+        if(fclose(out)){
+            perror(argv[optind + 1]);
+            return EXIT_FAILURE;
+        }
+        fprintf(stderr, "%zu frames\n", frames.size());
+    }
+    catch(const std::exception &e){
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
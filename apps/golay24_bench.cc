@@ -0,0 +1,198 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times Golay(24,12) (FEC type 2) encoding of random PDUs, per PDU and
+ * with the output PDU allocation included, the way fec_encoder does it.
+ * The old G matrix encoder that fec_encoder used before golay24 is kept
+ * here as the reference.
+ *
+ * Then times the two hard decoders fec_decoder can use for type 2, the
+ * syndrome table and the bitsliced decoder, on the 2048 codewords of a
+ * 6144 B frame with up to 3 errors each.
+ */
+
+#include "bit_utils.h"
+#include "golay24.h"
+#include <pmt/pmt.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using gr::tutorial::golay24;
+
+/* The old fec_encoder type 2 path, bit by bit through G */
+class legacy_encoder {
+public:
+    legacy_encoder()
+    {
+        G = new int*[12];
+        for (int i = 0; i < 12; i++) {
+            G[i] = new int[24];
+            for (int j = 0; j < 24; j++) {
+                G[i][j] = j < 12 ? P[i][j] : (i == j - 12);
+            }
+        }
+        for (int i = 0; i < 24; i++) {
+            u[i] = 0;
+        }
+    }
+
+    ~legacy_encoder()
+    {
+        for (int i = 0; i < 12; i++) {
+            delete[] G[i];
+        }
+        delete[] G;
+    }
+
+    pmt::pmt_t
+    encode(const uint8_t *bytes_in, size_t pdu_len)
+    {
+        uint8_t *buffer = new uint8_t[2 * pdu_len];
+        uint8_t *bit_buffer = new uint8_t[2 * pdu_len * 8];
+        uint8_t *bits_to_encode = new uint8_t[12];
+        size_t bits_to_encode_index = 0;
+        size_t bit_buffer_index = 0;
+
+        for(size_t i = 0; i < pdu_len; i++){
+            for(int j = 0; j < 8; j++){
+                bits_to_encode[bits_to_encode_index] = (bytes_in[i] & (1 << (7 - j))) >> (7 - j);
+                bits_to_encode_index++;
+                if(bits_to_encode_index == 12){
+                    for (int k = 0; k < 24; k++) {
+                        for (int l = 0; l < 12; l++) {
+                            u[k] = (u[k] + (bits_to_encode[l] * G[l][k])) % 2;
+                        }
+                        bit_buffer[bit_buffer_index] = u[k];
+                        bit_buffer_index++;
+                    }
+                    bits_to_encode_index = 0;
+                }
+            }
+        }
+
+        for(size_t i = 0; i < 2 * pdu_len; i++){
+            buffer[i] = (bit_buffer[8 * i] << 7) | (bit_buffer[(8 * i) + 1] << 6) | (bit_buffer[(8 * i) + 2] << 5) | (bit_buffer[(8 * i) + 3] << 4) | (bit_buffer[(8 * i) + 4] << 3) | (bit_buffer[(8 * i) + 5] << 2) | (bit_buffer[(8 * i) + 6] << 1) | (bit_buffer[(8 * i) + 7]);
+        }
+
+        pmt::pmt_t out = pmt::make_blob(buffer, 2 * pdu_len);
+        delete[] buffer;
+        delete[] bit_buffer;
+        delete[] bits_to_encode;
+        return out;
+    }
+
+private:
+    int u[24];
+    int **G;
+    static const int P[12][12];
+};
+
+const int legacy_encoder::P[12][12] = {{1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 1},
+                                       {0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 1, 1},
+                                       {0, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1},
+                                       {0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 1},
+                                       {1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1},
+                                       {1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1},
+                                       {1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1},
+                                       {0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 1},
+                                       {1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1},
+                                       {1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1},
+                                       {0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
+                                       {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0}};
+
+/* Runs f until at least 0.2 s have passed, returns microseconds per call */
+template <typename F>
+static double
+time_us(F f)
+{
+    typedef std::chrono::steady_clock clock;
+    size_t calls = 0;
+    clock::time_point start = clock::now();
+    std::chrono::duration<double, std::micro> elapsed;
+    do {
+        for (int i = 0; i < 16; i++) {
+            f();
+        }
+        calls += 16;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 2e5);
+    return elapsed.count() / calls;
+}
+
+int
+main()
+{
+    /*
+     * Type 2 drops PDUs whose length is not a multiple of 3, so 63 B
+     * stands in for a 64 B PDU.
+     */
+    const size_t sizes[] = {63, 1500, 6144};
+    golay24 golay;
+    legacy_encoder legacy;
+
+    srand(1);
+    printf("Golay(24,12) encode, us per PDU (63 B in place of 64 B, type 2 needs a multiple of 3)\n");
+    printf("%8s %12s %12s %8s\n", "PDU", "old", "golay24", "speedup");
+    for (size_t len : sizes) {
+        std::vector<uint8_t> in(len);
+        for (size_t i = 0; i < len; i++) {
+            in[i] = rand();
+        }
+
+        double t_old = time_us([&]() {
+            legacy.encode(in.data(), len);
+        });
+        double t_new = time_us([&]() {
+            size_t out_len;
+            pmt::pmt_t out = pmt::make_u8vector(2 * len, 0);
+            golay.encode(pmt::u8vector_writable_elements(out, out_len), in.data(), len);
+        });
+        printf("%6zu B %12.2f %12.2f %7.1fx\n", len, t_old, t_new, t_old / t_new);
+    }
+
+    const size_t ncodewords = 2048;
+    std::vector<uint32_t> received(ncodewords);
+    for (size_t i = 0; i < ncodewords; i++) {
+        received[i] = golay.encode(rand() & 0xfff);
+        for (int e = rand() % 4; e > 0; e--) {
+            received[i] ^= 1 << (rand() % 24);
+        }
+    }
+    std::vector<uint32_t> words(ncodewords);
+
+    double t_table = time_us([&]() {
+        words = received;
+        golay.correct(words.data(), ncodewords);
+    });
+    double t_sliced = time_us([&]() {
+        words = received;
+        golay.correct_bitsliced(words.data(), ncodewords);
+    });
+    printf("\nGolay(24,12) decode, %zu codewords\n", ncodewords);
+    printf("%-22s %8.1f us %6.1f ns/codeword\n", "syndrome table",
+           t_table, 1e3 * t_table / ncodewords);
+    printf("%-22s %8.1f us %6.1f ns/codeword\n",
+           gr::tutorial::bit_utils::have_avx2() ? "bitsliced, AVX2" : "bitsliced, 64-lane",
+           t_sliced, 1e3 * t_sliced / ncodewords);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,458 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bit_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TUTORIAL_BIT_UTILS_AVX2
+#define TUTORIAL_BIT_UTILS_BMI2
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace gr {
+namespace tutorial {
+namespace bit_utils {
+
+void
+transpose64(uint64_t a[64])
+{
+    /* Swap the off-diagonal j x j blocks for j = 32, 16, ..., 1 */
+    uint64_t m = 0x00000000ffffffffULL;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
+        }
+    }
+}
+
+void
+transpose32(uint32_t a[32])
+{
+    uint32_t m = 0x0000ffff;
+    for (int j = 16; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 32; k = ((k | j) + 1) & ~j) {
+            uint32_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
+        }
+    }
+}
+
+/*
+ * An 8x8 bit matrix in a word, first row in the top byte and first
+ * column in the top bit of every byte, transposed
+ */
+static inline uint64_t
+transpose8(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/*
+ * The kernels transpose rows 8 * g onwards of a, sa bytes each, into
+ * byte g onwards of the rows of b, sb bytes each. Byte k of 8, 16 or
+ * 32 rows makes up the bits of 8 columns, which go to rows 8 * k to
+ * 8 * k + 7 of b.
+ */
+static void
+transpose_rows8(uint8_t *b, const uint8_t *a, size_t g, size_t sa, size_t sb)
+{
+    const uint8_t *r = a + 8 * g * sa;
+    for (size_t k = 0; k < sa; k++) {
+        uint64_t x = 0;
+        for (int i = 0; i < 8; i++) {
+            x = (x << 8) | r[i * sa + k];
+        }
+        x = transpose8(x);
+        uint8_t *o = b + 8 * k * sb + g;
+        for (int j = 0; j < 8; j++) {
+            o[j * sb] = x >> (56 - 8 * j);
+        }
+    }
+}
+
+#ifdef __SSE2__
+/*
+ * The first row goes to the top byte of the register, so the sign
+ * bits of the bytes are a column with its first bit on top
+ */
+static void
+transpose_rows16(uint8_t *b, const uint8_t *a, size_t g, size_t sa, size_t sb)
+{
+    const uint8_t *r = a + 8 * g * sa;
+#define R(i) (char) r[(i) * sa + k]
+    for (size_t k = 0; k < sa; k++) {
+        __m128i v = _mm_set_epi8(R(0), R(1), R(2), R(3), R(4), R(5), R(6), R(7),
+                                 R(8), R(9), R(10), R(11), R(12), R(13), R(14), R(15));
+        uint8_t *o = b + 8 * k * sb + g;
+        for (int j = 0; j < 8; j++) {
+            uint32_t m = _mm_movemask_epi8(v);
+            o[j * sb] = m >> 8;
+            o[j * sb + 1] = m;
+            v = _mm_slli_epi64(v, 1);
+        }
+    }
+#undef R
+}
+#endif
+
+#ifdef TUTORIAL_BIT_UTILS_AVX2
+__attribute__((target("avx2"))) static void
+transpose_rows32(uint8_t *b, const uint8_t *a, size_t g, size_t sa, size_t sb)
+{
+    const uint8_t *r = a + 8 * g * sa;
+#define R(i) (char) r[(i) * sa + k]
+    for (size_t k = 0; k < sa; k++) {
+        __m256i v = _mm256_set_epi8(R(0), R(1), R(2), R(3), R(4), R(5), R(6), R(7),
+                                    R(8), R(9), R(10), R(11), R(12), R(13), R(14), R(15),
+                                    R(16), R(17), R(18), R(19), R(20), R(21), R(22), R(23),
+                                    R(24), R(25), R(26), R(27), R(28), R(29), R(30), R(31));
+        uint8_t *o = b + 8 * k * sb + g;
+        for (int j = 0; j < 8; j++) {
+            uint32_t m = _mm256_movemask_epi8(v);
+            o[j * sb] = m >> 24;
+            o[j * sb + 1] = m >> 16;
+            o[j * sb + 2] = m >> 8;
+            o[j * sb + 3] = m;
+            v = _mm256_slli_epi64(v, 1);
+        }
+    }
+#undef R
+}
+#endif
+
+/*
+ * For every row count r below 8, the bits of a byte spread out r apart,
+ * the first one on top of 8 * r bits
+ */
+static const struct spread_table {
+    uint64_t v[8][256];
+
+    spread_table()
+    {
+        for (int r = 1; r < 8; r++) {
+            for (int b = 0; b < 256; b++) {
+                uint64_t x = 0;
+                for (int j = 0; j < 8; j++) {
+                    x |= (uint64_t)((b >> (7 - j)) & 1) << (8 * r - 1 - j * r);
+                }
+                v[r][b] = x;
+            }
+        }
+    }
+} spread;
+
+/*
+ * Fewer than 8 rows of whole bytes: byte k of every row makes up 8
+ * columns, which are rows bytes of out from byte k * rows
+ */
+static void
+transpose_few_rows(uint8_t *out, const uint8_t *in, size_t rows, size_t sa)
+{
+    const uint64_t *t = spread.v[rows];
+    for (size_t k = 0; k < sa; k++) {
+        uint64_t x = 0;
+        for (size_t i = 0; i < rows; i++) {
+            x |= t[in[i * sa + k]] >> i;
+        }
+        for (size_t i = 0; i < rows; i++) {
+            out[k * rows + i] = x >> (8 * (rows - 1 - i));
+        }
+    }
+}
+
+/* The cols bytes from in, as the low bits of a word */
+static inline uint64_t
+load_be(const uint8_t *in, size_t cols)
+{
+    uint64_t x = 0;
+    for (size_t i = 0; i < cols; i++) {
+        x = (x << 8) | in[i];
+    }
+    return x;
+}
+
+/*
+ * Fewer than 8 columns, rows in groups of 8: group g is cols bytes of
+ * in, and gives byte g of every row of out
+ */
+static void
+transpose_few_cols(uint8_t *out, const uint8_t *in, size_t groups, size_t cols)
+{
+    const uint8_t mask = (1 << cols) - 1;
+    for (size_t g = 0; g < groups; g++) {
+        uint64_t x = load_be(in + g * cols, cols);
+        uint64_t y = 0;
+        for (size_t j = 0; j < 8; j++) {
+            y = (y << 8) | (((x >> (cols * (7 - j))) & mask) << (8 - cols));
+        }
+        y = transpose8(y);
+        for (size_t c = 0; c < cols; c++) {
+            out[c * groups + g] = y >> (56 - 8 * c);
+        }
+    }
+}
+
+#ifdef TUTORIAL_BIT_UTILS_BMI2
+/* The same, gathering column c with pext and mask m[c] */
+__attribute__((target("bmi2"))) static void
+transpose_few_cols_bmi2(uint8_t *out, const uint8_t *in, size_t groups,
+                        size_t cols, const uint64_t *m)
+{
+    for (size_t g = 0; g < groups; g++) {
+        uint64_t x = load_be(in + g * cols, cols);
+        for (size_t c = 0; c < cols; c++) {
+            out[c * groups + g] = _pext_u64(x, m[c]);
+        }
+    }
+}
+#endif
+
+/* n bits from bit pos of in, of len bytes, to out, zero padded to bytes */
+static void
+extract_bits(uint8_t *out, const uint8_t *in, size_t len, size_t pos, size_t n)
+{
+    size_t nb = (n + 7) / 8;
+    unsigned s = pos % 8;
+    in += pos / 8;
+    len -= pos / 8;
+    if (s == 0) {
+        memcpy(out, in, nb);
+    } else {
+        for (size_t i = 0; i < nb; i++) {
+            out[i] = (in[i] << s) | (i + 1 < len ? in[i + 1] >> (8 - s) : 0);
+        }
+    }
+    if (n % 8) {
+        out[nb - 1] &= 0xff << (8 - n % 8);
+    }
+}
+
+transpose_plan::transpose_plan(size_t rows, size_t cols)
+    : rows(rows),
+      cols(cols),
+      used(0)
+{
+    const size_t sa = (cols + 7) / 8;
+    const size_t groups = (rows + 7) / 8;
+
+    if (rows < 8 && cols % 8 == 0) {
+        kernel = FEW_ROWS;
+    } else if (cols < 8 && rows % 8 == 0) {
+        kernel = FEW_COLS;
+        for (size_t c = 0; c < cols; c++) {
+            masks[c] = 0;
+            for (size_t j = 0; j < 8; j++) {
+                masks[c] |= 1ULL << (8 * cols - 1 - cols * j - c);
+            }
+        }
+    } else if (rows % 8 == 0 && cols % 8 == 0) {
+        kernel = ALIGNED;
+    } else {
+        /*
+         * The tile kernels want rows that start on bytes, in groups of 8.
+         * Other shapes go through copies padded with zeros. The padding
+         * is never written, so the copies can serve every matrix.
+         */
+        kernel = PADDED;
+        pa.assign(8 * groups * sa, 0);
+        pb.resize(8 * sa * groups);
+    }
+}
+
+void
+transpose_bits(uint8_t *out, const uint8_t *in, transpose_plan &plan)
+{
+    const size_t rows = plan.rows;
+    const size_t cols = plan.cols;
+    if (rows == 0 || cols == 0) {
+        return;
+    }
+    const size_t len = (rows * cols + 7) / 8;
+    const size_t sa = (cols + 7) / 8;
+    const size_t groups = (rows + 7) / 8;
+    const size_t sb = groups;
+
+    switch (plan.kernel) {
+    case transpose_plan::FEW_ROWS:
+        transpose_few_rows(out, in, rows, sa);
+        return;
+    case transpose_plan::FEW_COLS:
+#ifdef TUTORIAL_BIT_UTILS_BMI2
+        if (have_bmi2()) {
+            transpose_few_cols_bmi2(out, in, groups, cols, plan.masks);
+            return;
+        }
+#endif
+        transpose_few_cols(out, in, groups, cols);
+        return;
+    default:
+        break;
+    }
+
+    const bool aligned = plan.kernel == transpose_plan::ALIGNED;
+    const uint8_t *a = in;
+    uint8_t *b = out;
+    if (!aligned) {
+        for (size_t r = 0; r < rows; r++) {
+            extract_bits(&plan.pa[r * sa], in, len, r * cols, cols);
+        }
+        a = plan.pa.data();
+        b = plan.pb.data();
+    }
+
+    size_t g = 0;
+#ifdef TUTORIAL_BIT_UTILS_AVX2
+    if (have_avx2()) {
+        for (; g + 4 <= groups; g += 4) {
+            transpose_rows32(b, a, g, sa, sb);
+        }
+    }
+#endif
+#ifdef __SSE2__
+    for (; g + 2 <= groups; g += 2) {
+        transpose_rows16(b, a, g, sa, sb);
+    }
+#endif
+    for (; g < groups; g++) {
+        transpose_rows8(b, a, g, sa, sb);
+    }
+
+    if (aligned) {
+        return;
+    }
+    /* Each of the first cols rows of b holds rows bits of out */
+    if (rows % 8 == 0) {
+        memcpy(out, b, cols * sb);
+        return;
+    }
+    memset(out, 0, len);
+    for (size_t c = 0; c < cols; c++) {
+        const uint8_t *src = b + c * sb;
+        size_t pos = c * rows;
+        uint8_t *o = out + pos / 8;
+        unsigned s = pos % 8;
+        size_t room = len - pos / 8;
+        for (size_t i = 0; i < sb; i++) {
+            o[i] |= src[i] >> s;
+            if (s && i + 1 < room) {
+                o[i + 1] |= src[i] << (8 - s);
+            }
+        }
+    }
+}
+
+void
+transpose_bits(uint8_t *out, const uint8_t *in, size_t rows, size_t cols)
+{
+    transpose_plan plan(rows, cols);
+    transpose_bits(out, in, plan);
+}
+
+transpose_cache::transpose_cache(size_t capacity)
+    : d_capacity(std::max(capacity, (size_t) 1)),
+      d_clock(0)
+{
+    d_plans.reserve(d_capacity);
+}
+
+void
+transpose_cache::transpose(uint8_t *out, const uint8_t *in, size_t rows, size_t cols)
+{
+    transpose_plan *plan = NULL;
+    for (transpose_plan &p : d_plans) {
+        if (p.rows == rows && p.cols == cols) {
+            plan = &p;
+            break;
+        }
+    }
+    if (!plan) {
+        if (d_plans.size() < d_capacity) {
+            d_plans.emplace_back(rows, cols);
+            plan = &d_plans.back();
+        } else {
+            plan = &*std::min_element(d_plans.begin(), d_plans.end(),
+                                      [](const transpose_plan &x, const transpose_plan &y) {
+                                          return x.used < y.used;
+                                      });
+            *plan = transpose_plan(rows, cols);
+        }
+    }
+    plan->used = ++d_clock;
+    transpose_bits(out, in, *plan);
+}
+
+bool
+have_avx2()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+bool
+have_bmi2()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool bmi2 = __builtin_cpu_supports("bmi2");
+    return bmi2;
+#else
+    return false;
+#endif
+}
+
+bool
+have_popcnt()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool popcnt = __builtin_cpu_supports("popcnt");
+    return popcnt;
+#else
+    return false;
+#endif
+}
+
+} // namespace bit_utils
+} /* namespace tutorial */
+} /* namespace gr */
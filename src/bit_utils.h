@@ -0,0 +1,111 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_BIT_UTILS_H
+#define INCLUDED_TUTORIAL_BIT_UTILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Bit-level helpers shared by the FEC, framing and interleaving blocks.
+ */
+namespace bit_utils {
+
+/*
+ * In-place transpose of a 64x64 bit matrix: on return bit i of a[j] is
+ * what bit j of a[i] was on entry.
+ */
+void transpose64(uint64_t a[64]);
+
+/* The same for a 32x32 bit matrix */
+void transpose32(uint32_t a[32]);
+
+/*
+ * Transposes a rows x cols bit matrix, stored row after row as packed
+ * MSB-first bits, so that out has it column after column: bit
+ * c * rows + r of out is bit r * cols + c of in. Both hold rows * cols
+ * bits, rounded up to whole bytes.
+ */
+void transpose_bits(uint8_t *out, const uint8_t *in, size_t rows, size_t cols);
+
+/*
+ * All transpose_bits works out from the shape of a matrix: the kernel
+ * that fits it, the pext masks, and the zero-padded copies of shapes
+ * whose rows do not start on bytes
+ */
+struct transpose_plan {
+    enum kernel_t {
+        ALIGNED,
+        FEW_ROWS,
+        FEW_COLS,
+        PADDED
+    };
+
+    size_t rows;
+    size_t cols;
+    kernel_t kernel;
+    uint64_t masks[8];
+    std::vector<uint8_t> pa;
+    std::vector<uint8_t> pb;
+    /* Last use, for transpose_cache */
+    uint64_t used;
+
+    transpose_plan(size_t rows, size_t cols);
+};
+
+/* transpose_bits for the shape of a plan, reusing its copies */
+void transpose_bits(uint8_t *out, const uint8_t *in, transpose_plan &plan);
+
+/*
+ * The plans of the last few shapes transposed. A new shape replaces the
+ * least recently used one once capacity plans are kept.
+ */
+class transpose_cache {
+public:
+    explicit transpose_cache(size_t capacity = 8);
+
+    void transpose(uint8_t *out, const uint8_t *in, size_t rows, size_t cols);
+
+private:
+    const size_t d_capacity;
+    std::vector<transpose_plan> d_plans;
+    uint64_t d_clock;
+};
+
+/* True if the CPU we run on supports AVX2 */
+bool have_avx2();
+
+/* True if the CPU we run on supports BMI2 (pext/pdep) */
+bool have_bmi2();
+
+/* True if the CPU we run on has the popcnt instruction */
+bool have_popcnt();
+
+} // namespace bit_utils
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_BIT_UTILS_H */
@@ -0,0 +1,338 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "conv_k7.h"
+#include "bit_utils.h"
+
+#include <algorithm>
+#include <bitset>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TUTORIAL_CONV_K7_AVX2
+#endif
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * The shift register holds the newest bit in bit 0, so the polynomials
+ * are the bit reversed 171 and 133. Both have their first and last taps
+ * set, which gives the Viterbi butterfly its symmetry.
+ */
+static const uint8_t POLY_A = 0x4f;
+static const uint8_t POLY_B = 0x6d;
+
+/*
+ * The ACS runs CHUNK steps between metric renormalisations. Decisions are
+ * kept in a ring of RING steps, and RELEASE bits are traced back at a time
+ * once the best path is DEPTH steps past them.
+ */
+static const size_t CHUNK = 64;
+static const size_t RELEASE = 1024;
+static const size_t DEPTH = 96;
+static const size_t RING = 2048;
+
+/* Start metric of the states the encoder cannot be in */
+static const uint8_t UNREACHABLE = 100;
+
+static int
+parity(uint32_t v)
+{
+    return std::bitset<8>(v).count() & 1;
+}
+
+/*
+ * One add-compare-select step per received symbol pair. Old states i and
+ * i + 32 feed new states 2i and 2i + 1. Bit s of dec[t] is set when new
+ * state s survived through old state (s >> 1) + 32.
+ *
+ * n steps grow the metrics by at most 2 * n, so afterwards the smallest
+ * metric is subtracted from all of them and returned.
+ */
+static uint8_t
+acs_generic(uint8_t metrics[64], const uint8_t branch[4][32],
+            const uint8_t *sym, size_t n, uint64_t *dec)
+{
+    uint8_t next[64];
+
+    for (size_t t = 0; t < n; t++) {
+        uint64_t d = 0;
+        for (int i = 0; i < 32; i++) {
+            uint8_t m = branch[sym[t]][i];
+            uint8_t mc = 2 - m;
+            uint8_t e0 = metrics[i] + m;
+            uint8_t e1 = metrics[i + 32] + mc;
+            uint8_t o0 = metrics[i] + mc;
+            uint8_t o1 = metrics[i + 32] + m;
+            next[2 * i] = std::min(e0, e1);
+            next[2 * i + 1] = std::min(o0, o1);
+            d |= (uint64_t)(e1 < e0) << (2 * i);
+            d |= (uint64_t)(o1 < o0) << (2 * i + 1);
+        }
+        std::copy(next, next + 64, metrics);
+        dec[t] = d;
+    }
+
+    uint8_t min = *std::min_element(metrics, metrics + 64);
+    for (int s = 0; s < 64; s++) {
+        metrics[s] -= min;
+    }
+    return min;
+}
+
+#ifdef __SSE2__
+/* Same step with 16 butterflies per register */
+static uint8_t
+acs_sse2(uint8_t metrics[64], const uint8_t branch[4][32],
+         const uint8_t *sym, size_t n, uint64_t *dec)
+{
+    __m128i m[4];
+
+    for (int k = 0; k < 4; k++) {
+        m[k] = _mm_load_si128((const __m128i *)(metrics + 16 * k));
+    }
+    for (size_t t = 0; t < n; t++) {
+        uint64_t d = 0;
+        __m128i next[4];
+        /* Butterflies 0..15 make states 0..31, 16..31 make 32..63 */
+        for (int h = 0; h < 2; h++) {
+            __m128i bm = _mm_loadu_si128((const __m128i *)(branch[sym[t]] + 16 * h));
+            __m128i bmc = _mm_loadu_si128((const __m128i *)(branch[3 - sym[t]] + 16 * h));
+            __m128i e0 = _mm_adds_epu8(m[h], bm);
+            __m128i e1 = _mm_adds_epu8(m[h + 2], bmc);
+            __m128i o0 = _mm_adds_epu8(m[h], bmc);
+            __m128i o1 = _mm_adds_epu8(m[h + 2], bm);
+            __m128i even = _mm_min_epu8(e0, e1);
+            __m128i odd = _mm_min_epu8(o0, o1);
+            __m128i de = _mm_cmpeq_epi8(even, e0);
+            __m128i dodd = _mm_cmpeq_epi8(odd, o0);
+
+            next[2 * h] = _mm_unpacklo_epi8(even, odd);
+            next[2 * h + 1] = _mm_unpackhi_epi8(even, odd);
+            uint32_t lo = _mm_movemask_epi8(_mm_unpacklo_epi8(de, dodd));
+            uint32_t hi = _mm_movemask_epi8(_mm_unpackhi_epi8(de, dodd));
+            d |= (uint64_t)(lo | (hi << 16)) << (32 * h);
+        }
+        for (int k = 0; k < 4; k++) {
+            m[k] = next[k];
+        }
+        dec[t] = ~d;
+    }
+
+    __m128i min = _mm_min_epu8(_mm_min_epu8(m[0], m[1]), _mm_min_epu8(m[2], m[3]));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 2));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 1));
+    uint8_t norm = _mm_cvtsi128_si32(min);
+    min = _mm_set1_epi8(norm);
+    for (int k = 0; k < 4; k++) {
+        _mm_store_si128((__m128i *)(metrics + 16 * k), _mm_subs_epu8(m[k], min));
+    }
+    return norm;
+}
+#endif
+
+#ifdef TUTORIAL_CONV_K7_AVX2
+/*
+ * All 32 butterflies in one register. The byte unpacks work within 128-bit
+ * lanes, so the interleaved halves are put back in state order with a
+ * lane permute.
+ */
+__attribute__((target("avx2"))) static uint8_t
+acs_avx2(uint8_t metrics[64], const uint8_t branch[4][32],
+         const uint8_t *sym, size_t n, uint64_t *dec)
+{
+    __m256i lo = _mm256_load_si256((const __m256i *)metrics);
+    __m256i hi = _mm256_load_si256((const __m256i *)(metrics + 32));
+
+    for (size_t t = 0; t < n; t++) {
+        __m256i bm = _mm256_loadu_si256((const __m256i *)branch[sym[t]]);
+        __m256i bmc = _mm256_loadu_si256((const __m256i *)branch[3 - sym[t]]);
+        __m256i e0 = _mm256_adds_epu8(lo, bm);
+        __m256i e1 = _mm256_adds_epu8(hi, bmc);
+        __m256i o0 = _mm256_adds_epu8(lo, bmc);
+        __m256i o1 = _mm256_adds_epu8(hi, bm);
+        __m256i even = _mm256_min_epu8(e0, e1);
+        __m256i odd = _mm256_min_epu8(o0, o1);
+        __m256i de = _mm256_cmpeq_epi8(even, e0);
+        __m256i dodd = _mm256_cmpeq_epi8(odd, o0);
+
+        __m256i a = _mm256_unpacklo_epi8(even, odd);
+        __m256i b = _mm256_unpackhi_epi8(even, odd);
+        lo = _mm256_permute2x128_si256(a, b, 0x20);
+        hi = _mm256_permute2x128_si256(a, b, 0x31);
+
+        /* Off the metric dependency chain, so this shuffle is cheap */
+        a = _mm256_unpacklo_epi8(de, dodd);
+        b = _mm256_unpackhi_epi8(de, dodd);
+        uint32_t d0 = _mm256_movemask_epi8(_mm256_permute2x128_si256(a, b, 0x20));
+        uint32_t d1 = _mm256_movemask_epi8(_mm256_permute2x128_si256(a, b, 0x31));
+        dec[t] = ~(((uint64_t)d1 << 32) | d0);
+    }
+
+    __m256i min = _mm256_min_epu8(lo, hi);
+    min = _mm256_min_epu8(min, _mm256_permute2x128_si256(min, min, 0x01));
+    min = _mm256_min_epu8(min, _mm256_srli_si256(min, 8));
+    min = _mm256_min_epu8(min, _mm256_srli_si256(min, 4));
+    min = _mm256_min_epu8(min, _mm256_srli_si256(min, 2));
+    min = _mm256_min_epu8(min, _mm256_srli_si256(min, 1));
+    min = _mm256_broadcastb_epi8(_mm256_castsi256_si128(min));
+    _mm256_store_si256((__m256i *)metrics, _mm256_subs_epu8(lo, min));
+    _mm256_store_si256((__m256i *)(metrics + 32), _mm256_subs_epu8(hi, min));
+    return _mm256_extract_epi8(min, 0);
+}
+#endif
+
+/*
+ * Follows the survivor path of state s backwards from step end - 1 down
+ * to step from, writing the decoded bits of the steps in [from, to). Both
+ * from and to must be multiples of 8.
+ */
+static void
+traceback(uint8_t *out, const uint64_t *dec, uint32_t s, size_t end,
+          size_t from, size_t to)
+{
+    uint32_t acc = 0;
+    size_t t = end;
+
+    while (t > to) {
+        t--;
+        s = (s >> 1) | (((dec[t % RING] >> s) & 1) << 5);
+    }
+    while (t > from) {
+        t--;
+        acc = (acc >> 1) | ((s & 1) << 7);
+        if (t % 8 == 0) {
+            out[t / 8] = acc;
+        }
+        s = (s >> 1) | (((dec[t % RING] >> s) & 1) << 5);
+    }
+}
+
+conv_k7::conv_k7()
+    : d_simd(true)
+{
+    for (uint32_t state = 0; state < 64; state++) {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t sr = state;
+            uint16_t v = 0;
+            for (int j = 7; j >= 0; j--) {
+                sr = (sr << 1) | ((b >> j) & 1);
+                v = (v << 2) | (parity(sr & POLY_A) << 1) | parity(sr & POLY_B);
+            }
+            d_encode_table[state][b] = v;
+        }
+    }
+
+    for (int s = 0; s < 4; s++) {
+        for (int i = 0; i < 32; i++) {
+            uint32_t sr = i << 1;
+            d_branch[s][i] = ((s >> 1) ^ parity(sr & POLY_A))
+                             + ((s & 1) ^ parity(sr & POLY_B));
+        }
+    }
+}
+
+void
+conv_k7::encode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    uint32_t state = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        uint16_t v = d_encode_table[state][in[i]];
+        out[2 * i] = v >> 8;
+        out[2 * i + 1] = v;
+        state = in[i] & 0x3f;
+    }
+
+    /* The 6 tail bits are the first 12 output bits of a zero byte */
+    uint16_t tail = d_encode_table[state][0];
+    out[2 * len] = tail >> 8;
+    out[2 * len + 1] = tail & 0xf0;
+}
+
+size_t
+conv_k7::decode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t nbits = 8 * decoded_len(len);
+    size_t nsteps = nbits + 6;
+    size_t done = 0;
+    size_t norm = 0;
+    alignas(32) uint8_t metrics[64];
+    uint64_t dec[RING];
+    uint8_t sym[CHUNK];
+
+    if (len < 2) {
+        return 0;
+    }
+
+    std::fill(metrics, metrics + 64, UNREACHABLE);
+    metrics[0] = 0;
+
+    for (size_t t = 0; t < nsteps; t += CHUNK) {
+        size_t n = std::min(CHUNK, nsteps - t);
+        for (size_t k = 0; k < n; k += 4) {
+            uint8_t b = in[(t + k) / 4];
+            sym[k] = b >> 6;
+            sym[k + 1] = (b >> 4) & 3;
+            sym[k + 2] = (b >> 2) & 3;
+            sym[k + 3] = b & 3;
+        }
+
+        if (!d_simd) {
+            norm += acs_generic(metrics, d_branch, sym, n, dec + t % RING);
+        } else
+#ifdef TUTORIAL_CONV_K7_AVX2
+        if (bit_utils::have_avx2()) {
+            norm += acs_avx2(metrics, d_branch, sym, n, dec + t % RING);
+        } else
+#endif
+        {
+#ifdef __SSE2__
+            norm += acs_sse2(metrics, d_branch, sym, n, dec + t % RING);
+#else
+            norm += acs_generic(metrics, d_branch, sym, n, dec + t % RING);
+#endif
+        }
+
+        /*
+         * Once the best path is DEPTH steps past the oldest pending bits,
+         * the survivors have merged there and those bits can be released.
+         */
+        if (t + n >= done + DEPTH + RELEASE) {
+            uint32_t best_state = std::min_element(metrics, metrics + 64) - metrics;
+            traceback(out, dec, best_state, t + n, done, done + RELEASE);
+            done += RELEASE;
+        }
+    }
+
+    /* The tail bits bring the encoder back to state 0 */
+    traceback(out, dec, 0, nsteps, done, nbits);
+    return norm + metrics[0];
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
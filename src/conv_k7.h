@@ -0,0 +1,93 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_CONV_K7_H
+#define INCLUDED_TUTORIAL_CONV_K7_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * CCSDS rate 1/2, constraint length 7 convolutional code with generator
+ * polynomials 171 and 133 (octal), working on packed data.
+ *
+ * Data bits enter the encoder MSB first and every bit produces the 171
+ * output bit followed by the 133 one. The encoder starts in the all zero
+ * state and is terminated with 6 zero tail bits, so len data bytes become
+ * 2 * len + 2 bytes, the last 4 bits being padding.
+ *
+ * Decoding is hard decision Viterbi. The add-compare-select step runs on
+ * all 64 states at once with SSE2, or AVX2 where available, and falls
+ * back to scalar code elsewhere. The survivor decisions live in a fixed
+ * size ring that is traced back in chunks, so memory use does not grow
+ * with the frame length.
+ */
+class conv_k7 {
+public:
+    conv_k7();
+
+    static size_t
+    encoded_len(size_t len)
+    {
+        return 2 * len + 2;
+    }
+
+    /* Number of data bytes carried by len coded bytes */
+    static size_t
+    decoded_len(size_t len)
+    {
+        return len < 2 ? 0 : (len - 2) / 2;
+    }
+
+    void encode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Decodes len coded bytes into decoded_len(len) bytes. Returns the
+     * number of received bits that differ from the decoded codeword.
+     */
+    size_t decode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /* Makes decode() use the scalar add-compare-select step, for testing */
+    void
+    set_simd(bool simd)
+    {
+        d_simd = simd;
+    }
+
+private:
+    bool d_simd;
+    /* Output bits for 8 input bits, indexed by start state and byte */
+    uint16_t d_encode_table[64][256];
+    /*
+     * Branch metric of butterfly i for every received symbol pair, for
+     * the branch leaving state i with a 0 input bit. The other branches
+     * of the butterfly have metric 2 - d_branch[sym][i] = d_branch[3 -
+     * sym][i].
+     */
+    uint8_t d_branch[4][32];
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_CONV_K7_H */
@@ -0,0 +1,380 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "correlator.h"
+#include "bit_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TUTORIAL_CORRELATOR_POPCNT
+#endif
+
+namespace gr {
+namespace tutorial {
+
+correlator::correlator(size_t len)
+    : d_len(len),
+      d_words((len + 63) / 64),
+      d_last_mask((len % 64) ? (1ULL << (len % 64)) - 1 : ~0ULL),
+      d_bits((len + CHUNK) / 64 + 2, 0),
+      d_start(0)
+{
+}
+
+size_t
+correlator::add_pattern(const std::vector<uint8_t> &bits)
+{
+    if (bits.size() != d_len) {
+        throw std::invalid_argument("correlator: Invalid pattern length");
+    }
+
+    size_t idx = d_patterns.size() / d_words;
+    d_patterns.resize(d_patterns.size() + d_words, 0);
+    uint64_t *p = &d_patterns[idx * d_words];
+    for (size_t i = 0; i < d_len; i++) {
+        p[i / 64] |= (uint64_t)(bits[i] != 0) << (i % 64);
+    }
+    return idx;
+}
+
+void
+correlator::reset()
+{
+    std::fill(d_bits.begin(), d_bits.end(), 0);
+    d_start = 0;
+}
+
+/* 64 window bits starting at bit pos of the packed stream */
+static inline uint64_t
+bits_at(const uint64_t *bits, size_t pos)
+{
+    size_t w = pos / 64;
+    size_t s = pos % 64;
+    return s ? (bits[w] >> s) | (bits[w + 1] << (64 - s)) : bits[w];
+}
+
+/* One input bit per byte, 64 of them into a word, the first one at bit 0 */
+static inline uint64_t
+pack64(const uint8_t *in)
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t w = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+        uint64_t m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xffff;
+        w |= m << (16 * i);
+    }
+    return w;
+#else
+    uint64_t w = 0;
+    for (int i = 0; i < 64; i++) {
+        w |= (uint64_t)(in[i] != 0) << i;
+    }
+    return w;
+#endif
+}
+
+/*
+ * nbits (up to 64) bits of packed MSB first input starting at bit pos,
+ * the first one at bit 0
+ */
+static inline uint64_t
+unpack64(const uint8_t *in, size_t pos, size_t nbits)
+{
+    const uint8_t *p = in + pos / 8;
+    size_t s = pos % 8;
+    size_t nbytes = (s + nbits + 7) / 8;
+    uint64_t w = 0;
+
+    for (size_t i = 0; i < std::min<size_t>(nbytes, 8); i++) {
+        w |= (uint64_t)p[i] << (8 * i);
+    }
+
+    /* Reverse the bits of every byte, so that the first bit is the LSB */
+    w = ((w >> 1) & 0x5555555555555555ULL) | ((w & 0x5555555555555555ULL) << 1);
+    w = ((w >> 2) & 0x3333333333333333ULL) | ((w & 0x3333333333333333ULL) << 2);
+    w = ((w >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((w & 0x0f0f0f0f0f0f0f0fULL) << 4);
+
+    w >>= s;
+    if (nbytes > 8) {
+        uint8_t b = p[8];
+        b = ((b >> 1) & 0x55) | ((b & 0x55) << 1);
+        b = ((b >> 2) & 0x33) | ((b & 0x33) << 2);
+        b = (b >> 4) | (b << 4);
+        w |= (uint64_t)b << (64 - s);
+    }
+    return nbits < 64 ? w & ((1ULL << nbits) - 1) : w;
+}
+
+/* Sign bits of 64 floats, the first one at bit 0 */
+static inline uint64_t
+sign64(const float *in)
+{
+#ifdef __SSE2__
+    const __m128 zero = _mm_setzero_ps();
+    uint64_t w = 0;
+    for (int i = 0; i < 16; i++) {
+        __m128 v = _mm_loadu_ps(in + 4 * i);
+        w |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(v, zero)) << (4 * i);
+    }
+    return w;
+#else
+    uint64_t w = 0;
+    for (int i = 0; i < 64; i++) {
+        w |= (uint64_t)(in[i] < 0) << i;
+    }
+    return w;
+#endif
+}
+
+/* Sign bits of 64 int8 values, the first one at bit 0 */
+static inline uint64_t
+sign64(const int8_t *in)
+{
+#ifdef __SSE2__
+    uint64_t w = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+        w |= (uint64_t)(_mm_movemask_epi8(v) & 0xffff) << (16 * i);
+    }
+    return w;
+#else
+    uint64_t w = 0;
+    for (int i = 0; i < 64; i++) {
+        w |= (uint64_t)(in[i] < 0) << i;
+    }
+    return w;
+#endif
+}
+
+/* nbits (up to 64) input bits starting at position pos */
+static uint64_t
+load_bits(const void *in, correlator::format_t format, size_t pos,
+          size_t nbits)
+{
+    uint64_t v = 0;
+
+    switch (format) {
+    case correlator::PACKED:
+        return unpack64((const uint8_t *)in, pos, nbits);
+    case correlator::FLOAT: {
+        const float *f = (const float *)in + pos;
+        if (nbits == 64) {
+            return sign64(f);
+        }
+        for (size_t j = 0; j < nbits; j++) {
+            v |= (uint64_t)(f[j] < 0) << j;
+        }
+        return v;
+    }
+    case correlator::INT8: {
+        const int8_t *b = (const int8_t *)in + pos;
+        if (nbits == 64) {
+            return sign64(b);
+        }
+        for (size_t j = 0; j < nbits; j++) {
+            v |= (uint64_t)(b[j] < 0) << j;
+        }
+        return v;
+    }
+    default: {
+        const uint8_t *b = (const uint8_t *)in + pos;
+        if (nbits == 64) {
+            return pack64(b);
+        }
+        for (size_t j = 0; j < nbits; j++) {
+            v |= (uint64_t)(b[j] != 0) << j;
+        }
+        return v;
+    }
+    }
+}
+
+/*
+ * Finds the first of the n window positions that follow the current
+ * window and matches a pattern. Position k is the window after k + 1 more
+ * bits, so it starts at bit d_start + k + 1.
+ */
+static inline __attribute__((always_inline)) size_t
+scan_positions(const uint64_t *bits, size_t start, size_t n,
+               const uint64_t *patterns, size_t npatterns, size_t words,
+               uint64_t last_mask, size_t threshold, int &match)
+{
+    for (size_t k = 0; k < n; k++) {
+        size_t pos = start + k + 1;
+        const uint64_t *p = patterns;
+        for (size_t j = 0; j < npatterns; j++) {
+            size_t d = 0;
+            for (size_t w = 0; w + 1 < words; w++) {
+                d += __builtin_popcountll(bits_at(bits, pos + 64 * w) ^ p[w]);
+            }
+            d += __builtin_popcountll((bits_at(bits, pos + 64 * (words - 1))
+                                       ^ p[words - 1]) & last_mask);
+            if (d <= threshold) {
+                match = j;
+                return k + 1;
+            }
+            p += words;
+        }
+    }
+    match = -1;
+    return n;
+}
+
+#ifdef TUTORIAL_CORRELATOR_POPCNT
+__attribute__((target("popcnt"))) static size_t
+scan_popcnt(const uint64_t *bits, size_t start, size_t n,
+            const uint64_t *patterns, size_t npatterns, size_t words,
+            uint64_t last_mask, size_t threshold, int &match)
+{
+    return scan_positions(bits, start, n, patterns, npatterns, words,
+                          last_mask, threshold, match);
+}
+#endif
+
+static size_t
+scan_generic(const uint64_t *bits, size_t start, size_t n,
+             const uint64_t *patterns, size_t npatterns, size_t words,
+             uint64_t last_mask, size_t threshold, int &match)
+{
+    return scan_positions(bits, start, n, patterns, npatterns, words,
+                          last_mask, threshold, match);
+}
+
+size_t
+correlator::scan(size_t n, size_t threshold, int &match) const
+{
+    size_t npatterns = d_patterns.size() / d_words;
+    if (npatterns == 0) {
+        match = -1;
+        return n;
+    }
+    /* An empty window matches anything */
+    if (d_words == 0) {
+        match = 0;
+        return 1;
+    }
+#ifdef TUTORIAL_CORRELATOR_POPCNT
+    if (bit_utils::have_popcnt()) {
+        return scan_popcnt(d_bits.data(), d_start, n, d_patterns.data(),
+                           npatterns, d_words, d_last_mask, threshold, match);
+    }
+#endif
+    return scan_generic(d_bits.data(), d_start, n, d_patterns.data(),
+                        npatterns, d_words, d_last_mask, threshold, match);
+}
+
+size_t
+correlator::distance(size_t pattern) const
+{
+    const uint64_t *p = &d_patterns[pattern * d_words];
+    size_t d = 0;
+
+    for (size_t w = 0; w < d_words; w++) {
+        uint64_t x = bits_at(d_bits.data(), d_start + 64 * w) ^ p[w];
+        if (w + 1 == d_words) {
+            x &= d_last_mask;
+        }
+        d += __builtin_popcountll(x);
+    }
+    return d;
+}
+
+size_t
+correlator::search(const uint8_t *in, size_t n, size_t threshold, int &match)
+{
+    return search_bits(in, UNPACKED, 0, n, threshold, match);
+}
+
+size_t
+correlator::search_packed(const uint8_t *in, size_t offset, size_t n,
+                          size_t threshold, int &match)
+{
+    return search_bits(in, PACKED, offset, n, threshold, match);
+}
+
+size_t
+correlator::search_soft(const float *in, size_t n, size_t threshold,
+                        int &match)
+{
+    return search_bits(in, FLOAT, 0, n, threshold, match);
+}
+
+size_t
+correlator::search_soft(const int8_t *in, size_t n, size_t threshold,
+                        int &match)
+{
+    return search_bits(in, INT8, 0, n, threshold, match);
+}
+
+size_t
+correlator::search_bits(const void *in, format_t format, size_t offset,
+                        size_t n, size_t threshold, int &match)
+{
+    size_t consumed = 0;
+
+    match = -1;
+    while (consumed < n) {
+        size_t k = std::min((size_t) CHUNK, n - consumed);
+
+        /* Append the chunk after the window */
+        size_t end = d_start + d_len;
+        for (size_t i = 0; i < k; i += 64) {
+            uint64_t v = load_bits(in, format, offset + consumed + i,
+                                   std::min<size_t>(64, k - i));
+            size_t pos = end + i;
+            size_t s = pos % 64;
+            d_bits[pos / 64] = (d_bits[pos / 64] & ((1ULL << s) - 1)) | (v << s);
+            if (s) {
+                d_bits[pos / 64 + 1] = v >> (64 - s);
+            }
+        }
+
+        size_t used = scan(k, threshold, match);
+        consumed += used;
+
+        /* Move the window to the front, keeping its bit alignment */
+        size_t first = (d_start + used) / 64;
+        size_t last = (d_start + used + d_len - 1) / 64;
+        std::copy(d_bits.begin() + first, d_bits.begin() + last + 1,
+                  d_bits.begin());
+        d_start = (d_start + used) % 64;
+
+        if (match >= 0) {
+            break;
+        }
+    }
+    return consumed;
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
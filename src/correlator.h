@@ -0,0 +1,119 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_CORRELATOR_H
+#define INCLUDED_TUTORIAL_CORRELATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Sliding window bit correlator for the frame synchronizer.
+ *
+ * The window holds the last len received bits, starting out as zeros. The
+ * reference patterns are given oldest bit first, one bit per byte, and
+ * the window matches a pattern when they differ in at most threshold bits.
+ * An empty window matches the first pattern at every position.
+ *
+ * Input bits, one per byte with any non-zero byte meaning 1, are packed 64
+ * at a time (with SSE2 where available) after the bits already in the
+ * window. Packed input is copied in 64 bits at a time, and soft symbols
+ * give their sign bits. Every window position is then compared against every pattern
+ * with one popcount per 64 bits of pattern, instead of shifting the
+ * window bit by bit.
+ */
+class correlator {
+public:
+    correlator(size_t len);
+
+    size_t
+    len() const
+    {
+        return d_len;
+    }
+
+    /* Adds a reference pattern of len bits and returns its index */
+    size_t add_pattern(const std::vector<uint8_t> &bits);
+
+    /* Clears the window back to all zeros */
+    void reset();
+
+    /* Bits in which the window differs from pattern */
+    size_t distance(size_t pattern) const;
+
+    /*
+     * Shifts the n bits of in into the window until it matches one of the
+     * patterns. Returns the bits consumed, the matching one included, and
+     * sets match to the first matching pattern, or to -1 if none of the n
+     * window positions matched.
+     */
+    size_t search(const uint8_t *in, size_t n, size_t threshold, int &match);
+
+    /*
+     * The same for packed input, 8 bits per byte MSB first, starting at
+     * bit offset of in.
+     */
+    size_t search_packed(const uint8_t *in, size_t offset, size_t n,
+                         size_t threshold, int &match);
+
+    /* The same for soft symbols, a negative one being a 1 bit */
+    size_t search_soft(const float *in, size_t n, size_t threshold,
+                       int &match);
+    size_t search_soft(const int8_t *in, size_t n, size_t threshold,
+                       int &match);
+
+    /* Input representations */
+    typedef enum {
+        UNPACKED,
+        PACKED,
+        FLOAT,
+        INT8
+    } format_t;
+
+private:
+    /* Input bits packed per search step */
+    static const size_t CHUNK = 4096;
+
+    const size_t d_len;
+    const size_t d_words;
+    /* Patterns packed like the window, d_words words each */
+    std::vector<uint64_t> d_patterns;
+    /* Valid bits of the last word of a pattern */
+    uint64_t d_last_mask;
+    /*
+     * The window followed by the bits of the current chunk, packed LSB
+     * first. The window occupies bits d_start .. d_start + d_len - 1.
+     */
+    std::vector<uint64_t> d_bits;
+    size_t d_start;
+
+    size_t scan(size_t n, size_t threshold, int &match) const;
+    size_t search_bits(const void *in, format_t format, size_t offset,
+                       size_t n, size_t threshold, int &match);
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_CORRELATOR_H */
@@ -0,0 +1,61 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "crc.h"
+
+namespace gr {
+namespace tutorial {
+namespace crc {
+
+uint8_t
+crc8(const uint8_t *data, size_t len)
+{
+    uint8_t c = 0;
+
+    for(size_t i = 0; i < len; i++){
+        c ^= data[i];
+        for(int j = 0; j < 8; j++){
+            c = (c & 0x80) ? (c << 1) ^ 0x07 : c << 1;
+        }
+    }
+    return c;
+}
+
+uint16_t
+crc16(const uint8_t *data, size_t len)
+{
+    uint16_t c = 0xffff;
+
+    for(size_t i = 0; i < len; i++){
+        c ^= data[i] << 8;
+        for(int j = 0; j < 8; j++){
+            c = (c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1;
+        }
+    }
+    return c;
+}
+
+} // namespace crc
+} /* namespace tutorial */
+} /* namespace gr */
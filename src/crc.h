@@ -0,0 +1,47 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_CRC_H
+#define INCLUDED_TUTORIAL_CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Bitwise CRCs for short fields such as frame headers, MSB first and
+ * without reflection or final XOR.
+ */
+namespace crc {
+
+/* CRC-8 with polynomial 0x07 and zero initial value */
+uint8_t crc8(const uint8_t *data, size_t len);
+
+/* CRC-16 with polynomial 0x1021 and initial value 0xffff (CCITT-FALSE) */
+uint16_t crc16(const uint8_t *data, size_t len);
+
+} // namespace crc
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_CRC_H */
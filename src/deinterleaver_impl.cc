@@ -24,6 +24,8 @@
 
 #include <gnuradio/io_signature.h>
 #include "deinterleaver_impl.h"
+#include <iostream>
+#include <stdexcept>
 
 namespace gr {
 namespace tutorial {
@@ -45,6 +47,9 @@ deinterleaver_impl::deinterleaver_impl(size_t block_size)
                 gr::io_signature::make(0, 0, 0)),
                 d_block_size(block_size)
 {
+    if(block_size == 0){
+        throw std::invalid_argument("deinterleaver: Invalid block size");
+    }
     message_port_register_in(pmt::mp("pdu_in"));
     message_port_register_out(pmt::mp("pdu_out"));
 
@@ -55,10 +60,6 @@ deinterleaver_impl::deinterleaver_impl(size_t block_size)
     [this](pmt::pmt_t msg) {
         this->deinterleaver_impl::deinterleave(msg);
     });
-
-    interleave_table = new uint8_t*[block_size];
-    for(int i = 0; i < block_size; i++)
-        interleave_table[i] = new uint8_t[block_size];
 }
 
 /*
@@ -66,63 +67,36 @@ deinterleaver_impl::deinterleaver_impl(size_t block_size)
  */
 deinterleaver_impl::~deinterleaver_impl()
 {
-    for(int i = 0; i < d_block_size; i++)
-        delete[] interleave_table[i];
-    delete[] interleave_table;
 }
 
 void
 deinterleaver_impl::deinterleave(pmt::pmt_t m)
 {
-    pmt::pmt_t meta(pmt::car(m));
     pmt::pmt_t bytes(pmt::cdr(m));
 
     size_t pdu_len;
     const uint8_t *bytes_in = pmt::u8vector_elements(bytes, pdu_len);
 
-    size_t row = 0;
-    size_t col = 0;
     size_t max_rows = (8 * pdu_len) / d_block_size;
 
-    uint8_t bit_buffer[pdu_len * 8];
-    size_t bitBufferIntex = 0;
-    uint8_t buffer[pdu_len];
-
-    /* TODO: Add your code here */
-
-    if(max_rows >= d_block_size){
+    if(max_rows > d_block_size){
         std::cout << "Warning at Deinterleaver: Too small block size for all the data! Dropping frame." << std::endl;
         return;
     }
-
-    for(int i = 0; i < pdu_len; i++){
-        for(int j = 7; j >= 0; j--){
-            interleave_table[row][col] = ((bytes_in[i] >> j) & 1);
-            row++;
-            if(row == max_rows){
-                col++;
-                row = 0;
-            }
-        }
-    }
-
-    for(int _row = 0; _row < max_rows; _row++){
-        for(int _col = 0; _col < d_block_size; _col++){
-            bit_buffer[bitBufferIntex] = interleave_table[_row][_col];
-            bitBufferIntex++;
-        }
-    }
-
-    for(int i = 0; i < pdu_len; i++){
-            buffer[i] = (bit_buffer[8 * i] << 7) | (bit_buffer[(8 * i) + 1] << 6) | (bit_buffer[(8 * i) + 2] << 5) | (bit_buffer[(8 * i) + 3] << 4) | (bit_buffer[(8 * i) + 4] << 3) | (bit_buffer[(8 * i) + 5] << 2) | (bit_buffer[(8 * i) + 6] << 1) | (bit_buffer[(8 * i) + 7]);
+    if(((pdu_len * 8) % d_block_size) != 0){
+        return;
     }
 
     /*
-     * FIXME: This just copies the input to the output. Even you do not
-     * implement the interleaver, it will forward the input message to the next
-     * block and everything should work fine
+     * The interleaver read its table column after column, so the bits
+     * are a d_block_size x max_rows matrix, put back row after row
      */
-    message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, pdu_len)));
+    size_t out_len;
+    pmt::pmt_t out = pmt::make_u8vector(pdu_len, 0);
+    d_plans.transpose(pmt::u8vector_writable_elements(out, out_len),
+                      bytes_in, d_block_size, max_rows);
+
+    message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
 }
 
 
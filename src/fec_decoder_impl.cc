@@ -24,26 +24,29 @@
 
 #include <gnuradio/io_signature.h>
 #include "fec_decoder_impl.h"
+#include <algorithm>
 
 namespace gr {
 namespace tutorial {
 
 fec_decoder::sptr
-fec_decoder::make(int type)
+fec_decoder::make(int type, size_t rs_block_len, bool golay_bitsliced)
 {
     return gnuradio::get_initial_sptr
-           (new fec_decoder_impl(type));
+           (new fec_decoder_impl(type, rs_block_len, golay_bitsliced));
 }
 
 
 /*
  * The private constructor
  */
-fec_decoder_impl::fec_decoder_impl(int type)
+fec_decoder_impl::fec_decoder_impl(int type, size_t rs_block_len,
+                                   bool golay_bitsliced)
     : gr::block("fec_encoder",
                 gr::io_signature::make(0, 0, 0),
                 gr::io_signature::make(0, 0, 0)),
-      d_type(type)
+      d_type(type),
+      d_rs(rs_block_len)
 {
     message_port_register_in(pmt::mp("pdu_in"));
     message_port_register_out(pmt::mp("pdu_out"));
@@ -56,43 +59,12 @@ fec_decoder_impl::fec_decoder_impl(int type)
         this->fec_decoder_impl::decode(msg);
     });
 
-    hamming_lookup = new uint8_t[8]{0, 0, 0, 1, 0, 1, 1, 1};
-
-    if(type == 2){
-        G = new int*[12];
-        HT = new int*[24];
-
-        for (int i = 0; i < 12; ++i) {
-            G[i] = new int[24];
-        }
-
-        for (int i = 0; i < 24; ++i) {
-            HT[i] = new int[12];
-        }
-
-        int I[12][12] = {};
-        for (int i = 0; i < 12; i++) {
-            for (int j = 0; j < 12; j++) {
-                if (i == j) {
-                    I[i][j] = 1;
-                } else {
-                    I[i][j] = 0;
-                }
-            }
-        }
-
-        for (int i = 0; i < 12; i++) {
-            for (int j = 0; j < 24; j++) {
-                if (j < 12) {
-                    HT[j][i] = I[i][j];
-                    G[i][j] = P[i][j];
-                } else {
-                    G[i][j] = I[i][j - 12];
-                    HT[j][i] = P[i][j - 12];
-                }
-            }
-        }
-    }
+    /*
+     * The syndrome table is several times faster while its 32 KB stay in
+     * L1. The bitsliced decoder needs no tables, for hosts where other
+     * blocks keep evicting them.
+     */
+    d_golay.set_bitsliced(golay_bitsliced);
 }
 
 /*
@@ -100,29 +72,60 @@ fec_decoder_impl::fec_decoder_impl(int type)
  */
 fec_decoder_impl::~fec_decoder_impl()
 {
-    delete hamming_lookup;
-
-    if(d_type == 2){
-        for (int i = 0; i < 12; ++i) {
-            delete G[i];
-        }
-
-        delete G;
-
-        for (int i = 0; i < 24; ++i) {
-            delete HT[i];
-        }
+}
 
-        delete HT;
+/*
+ * Decoder statistics travel with the decoded PDU in its metadata
+ * dictionary, next to whatever metadata arrived with the coded PDU.
+ */
+static pmt::pmt_t
+add_stat(pmt::pmt_t meta, const char *key, size_t value)
+{
+    if (!pmt::is_dict(meta)) {
+        meta = pmt::make_dict();
     }
+    return pmt::dict_add(meta, pmt::mp(key), pmt::from_uint64(value));
 }
 
-int weight(int *v) {
-    int weight = 0;
-    for (int i = 0; i < 12; i++) {
-        weight += v[i];
+/*
+ * Soft decoders take their input as LLRs, a positive value meaning a 0
+ * bit. Packed hard bits map to a fixed confidence, floats are scaled by 4
+ * so that an LLR of 1.0 keeps some resolution in int8, and int8 input is
+ * taken as is. Returns false for any other PDU type.
+ */
+static bool
+to_llr(pmt::pmt_t v, std::vector<int8_t> &llr)
+{
+    size_t len;
+
+    if (pmt::is_u8vector(v)) {
+        const uint8_t *in = pmt::u8vector_elements(v, len);
+        llr.resize(8 * len);
+        for (size_t i = 0; i < len; i++) {
+            for (size_t j = 0; j < 8; j++) {
+                llr[8 * i + j] = ((in[i] >> (7 - j)) & 1) ? -16 : 16;
+            }
+        }
+        return true;
+    }
+    if (pmt::is_f32vector(v)) {
+        const float *in = pmt::f32vector_elements(v, len);
+        llr.resize(len);
+        for (size_t i = 0; i < len; i++) {
+            float x = std::min(std::max(4.0f * in[i], -127.0f), 127.0f);
+            llr[i] = (int8_t)(x < 0 ? x - 0.5f : x + 0.5f);
+        }
+        return true;
     }
-    return weight;
+    if (pmt::is_s8vector(v)) {
+        const int8_t *in = pmt::s8vector_elements(v, len);
+        llr.resize(len);
+        for (size_t i = 0; i < len; i++) {
+            llr[i] = std::max(in[i], (int8_t) -127);
+        }
+        return true;
+    }
+    return false;
 }
 
 void
@@ -131,20 +134,29 @@ fec_decoder_impl::decode(pmt::pmt_t m)
     pmt::pmt_t meta(pmt::car(m));
     pmt::pmt_t bytes(pmt::cdr(m));
 
-    size_t pdu_len;
-    const uint8_t *bytes_in = pmt::u8vector_elements(bytes, pdu_len);
-    uint8_t bit_in_0;
-    uint8_t bit_in_1;
-    uint8_t bit_in_2;
-    uint8_t bits_taken = 0;
-    size_t bitBufferIntex = 0;
-
-    uint8_t *bits_to_decode;
-    size_t bits_to_decode_index = 0;
-    size_t bit_buffer_index = 0;
-    int e[24];
-    bool decodable = true;
-    int sp[12] = {};
+    size_t pdu_len = 0;
+    const uint8_t *bytes_in = NULL;
+    pmt::pmt_t out;
+    size_t out_len;
+    size_t corrected;
+    size_t detected;
+
+    /*
+     * Hard bits come packed in a u8vector, LLRs in an f32vector or an
+     * s8vector. Only the repetition, Golay, LDPC and Golay product
+     * decoders accept LLRs.
+     */
+    if (pmt::is_u8vector(bytes)) {
+        bytes_in = pmt::u8vector_elements(bytes, pdu_len);
+    }
+    else if (!pmt::is_f32vector(bytes) && !pmt::is_s8vector(bytes)) {
+        std::cout << "Warning: fec_decoder dropped a message of unknown type!" << std::endl;
+        return;
+    }
+    else if (d_type != 0 && d_type != 1 && d_type != 2 && d_type != 7 && d_type != 8) {
+        std::cout << "Warning: fec_decoder dropped LLRs its FEC cannot use!" << std::endl;
+        return;
+    }
 
     switch (d_type) {
     /* No FEC just copy the input message to the output */
@@ -152,179 +164,151 @@ fec_decoder_impl::decode(pmt::pmt_t m)
         message_port_pub(pmt::mp("pdu_out"), m);
         return;
     case 1:
-        /* Do Hamming decoding */
-        buffer = new uint8_t[pdu_len / 3];
-        bit_buffer = new uint8_t[(pdu_len / 3) * 8];
-
-        for(int i = 0; i < pdu_len; i++){
-            for(int j = 7; j >= 0; j--){
-                switch(bits_taken){
-                    case 0:
-                        bit_in_0 = (bytes_in[i] >> j) & 1;
-                        bits_taken++;
-                        break;
-                    case 1:
-                        bit_in_1 = (bytes_in[i] >> j) & 1;
-                        bits_taken++;
-                        break;
-                    case 2:
-                        bit_in_2 = (bytes_in[i] >> j) & 1;
-                        bit_buffer[bitBufferIntex] = hamming_lookup[(bit_in_0 << 2) | (bit_in_1 << 1) | (bit_in_2)];
-                        bitBufferIntex++;
-                        bits_taken = 0;
-                        break;
-                }
+        if (!bytes_in) {
+            /* Do soft repetition decoding, sum of every three LLRs */
+            to_llr(bytes, d_llr);
+            out = pmt::make_u8vector(d_llr.size() / 24, 0);
+            d_repetition.decode_soft(pmt::u8vector_writable_elements(out, out_len), d_llr.data(), d_llr.size());
+
+            message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+            return;
+        }
+
+        /* Do repetition decoding, majority of every three bits */
+        out = pmt::make_u8vector(pdu_len / 3, 0);
+        d_repetition.decode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 2:
+        if (!bytes_in) {
+            /* Do Chase-II Golay decoding, two codewords per 48 LLRs */
+            if(!to_llr(bytes, d_llr) || d_llr.size() % 48 != 0){
+                std::cout << "Warning: fec_decoder dropped a message because it's not a mul of 48 LLRs!" << std::endl;
+                return;
             }
+
+            out = pmt::make_u8vector(d_llr.size() / 16, 0);
+            detected = d_golay.decode_soft(pmt::u8vector_writable_elements(out, out_len), d_llr.data(), d_llr.size());
+
+            meta = add_stat(meta, "fec_uncorrectable", detected);
+            message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
+            return;
         }
 
-        for(int i = 0; i < pdu_len / 3; i++){
-            buffer[i] = (bit_buffer[8 * i] << 7) | (bit_buffer[(8 * i) + 1] << 6) | (bit_buffer[(8 * i) + 2] << 5) | (bit_buffer[(8 * i) + 3] << 4) | (bit_buffer[(8 * i) + 4] << 3) | (bit_buffer[(8 * i) + 5] << 2) | (bit_buffer[(8 * i) + 6] << 1) | (bit_buffer[(8 * i) + 7]);
+        /* Do Golay decoding */
+        if(pdu_len % 6 != 0){
+            std::cout << "Warning: fec_decoder dropped a message because it's not a mul of 6!" << std::endl;
+            return;
         }
 
-        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, pdu_len / 3)));
+        /* Syndrome table lookup or bitsliced, two codewords per 6 input bytes */
+        out = pmt::make_u8vector(pdu_len / 2, 0);
+        detected = d_golay.decode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
 
-        delete buffer;
-        delete bit_buffer;
+        meta = add_stat(meta, "fec_uncorrectable", detected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
         return;
-    case 2:
-        /* Do Golay decoding */
+    case 3:
+        /* Do Hamming(7,4) decoding */
+        out = pmt::make_u8vector(hamming::decoded_len_74(pdu_len), 0);
+        corrected = d_hamming.decode_74(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
 
-        buffer = new uint8_t[2 * pdu_len];
-        bit_buffer = new uint8_t[2 * pdu_len * 8];
-        bits_to_decode = new uint8_t[12];
-
-        for(int k = 0; k < pdu_len; k++){
-            for(int l = 7; l >= 0; l--){
-                bits_to_decode[bits_to_decode_index] = ((bytes_in[k] >> l) & 1);
-                bits_to_decode_index++;
-                if(bits_to_decode_index == 12){
-                    for (int m = 0; m < 24; m++) {
-                        e[m] = 0;
-                        //s[m] = 0;
-                        if(m < 12)
-                            sp[m] = 0;
-                    }
-
-                    for (int i = 0; i < 24; i++) {
-                        for (int j = 0; j < 12; j++) {
-                            s[j] = (s[j] + ((bits_to_decode[i] * HT[i][j]) % 2)) % 2;
-                        }
-                    }
-
-                    if (weight(s) <= 3) {
-                        for (int i = 0; i < 24; i++) {
-                            if (i < 12) {
-                                e[i] = s[i];
-                            } else {
-                                e[i] = 0;
-                            }
-                        }
-                        goto result;
-                    }
-
-                    // if w(s + pi) <= 2 for some pi then set e = (s + pi, u(i))
-                    else {
-                        for (int i = 0; i < 12; i++) {
-                            int spi[12] = {};
-                            for (int j = 0; j < 12; j++) {
-                                spi[j] = s[j];
-                            }
-                            for (int j = 0; j < 12; j++) {
-                                spi[j] = (spi[j] + P[i][j]) % 2;
-                            }
-                            if (weight(spi) <= 2) {
-                                for (int k = 0; k < 24; k++) {
-                                    if (k < 12) {
-                                        e[k] = spi[k];
-                                    } else {
-                                        e[k] = (i == (k - 12));
-                                    }
-                                }
-                                goto result;
-                            }
-                        }
-                    }
-
-                    for (int i = 0; i < 12; i++) {
-                        for (int j = 0; j < 12; j++) {
-                            sp[j] = (sp[j] + ((s[i] * P[i][j]) % 2)) % 2;
-                        }
-                    }
-
-                    // if w(s*P) = 2 or w(s*P) = 3 then set e = (0, s*P)
-                    if (weight(sp) == 2 || weight(sp) == 3) {
-                        for (int i = 0; i < 24; i++) {
-                            if (i < 12) {
-                                e[i] = 0;
-                            } else {
-                                e[i] = sp[i - 12];
-                            }
-                        }
-                        goto result;
-                    }
-
-                    // if w(s*P + pi) = 2 for some pi then set e = (u(i), s*P + pi)
-                    else {
-                        for (int i = 0; i < 12; i++) {
-                            int sppi[12] = {};
-                            for (int j = 0; j < 12; j++) {
-                                sppi[j] = sp[j];
-                            }
-                            for (int j = 0; j < 12; j++) {
-                                sppi[j] = (sppi[j] + P[i][j]) % 2;
-                            }
-                            if (weight(sppi) == 2) {
-                                for (int k = 0; k < 24; k++) {
-                                    if (k < 12) {
-                                        e[k] = (i == k);
-                                    } else {
-                                        e[k] = sppi[k - 12];
-                                    }
-                                }
-                                goto result;
-                            }
-                        }
-                    }
-
-                    // if pattern is not correctable, request retransmission
-                    decodable = false;
-result:
-                    /*
-                    std::cout << "Error pattern: ";
-                    for (int i = 0; i < 24; i++) {
-                        std::cout << e[i];
-                    }
-                    std::cout << std::endl;
-                    */
-
-                    if (decodable) {
-                        for (int i = 0; i < 12; i++) {
-                            bit_buffer[bit_buffer_index] = (bits_to_decode[i + 12] + e[i]) % 2;
-                            bit_buffer_index++;
-                        }
-                    } else {
-                        for (int i = 0; i < 12; i++) {
-                            bit_buffer[bit_buffer_index] = 0;
-                            bit_buffer_index++;
-                        }
-                        decodable = true;
-                    }
-                    bits_to_decode_index = 0;
-                }
-            }
+        meta = add_stat(meta, "fec_corrected", corrected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
+        return;
+    case 4:
+        /* Do Hamming(8,4) decoding, reporting double errors */
+        out = pmt::make_u8vector(pdu_len / 2, 0);
+        corrected = d_hamming.decode_84(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len, detected);
+
+        meta = add_stat(meta, "fec_corrected", corrected);
+        meta = add_stat(meta, "fec_uncorrectable", detected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
+        return;
+    case 5:
+        /* Do hard decision Viterbi decoding of the K=7 code */
+        out = pmt::make_u8vector(conv_k7::decoded_len(pdu_len), 0);
+        corrected = d_conv.decode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        meta = add_stat(meta, "fec_corrected", corrected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
+        return;
+    case 6:
+        /* Do RS(255,223) decoding */
+        out_len = d_rs.decoded_len(pdu_len);
+        if(pdu_len != 0 && out_len == 0){
+            std::cout << "Warning: fec_decoder dropped a message that is not a sequence of RS blocks!" << std::endl;
+            return;
+        }
+
+        out = pmt::make_u8vector(out_len, 0);
+        corrected = d_rs.decode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len, detected);
+
+        meta = add_stat(meta, "fec_corrected", corrected);
+        meta = add_stat(meta, "fec_uncorrectable", detected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
+        return;
+    case 7: {
+        /* Do layered min-sum LDPC decoding on hard bits or LLRs */
+        if(!to_llr(bytes, d_llr) || d_llr.size() % ldpc::N != 0){
+            std::cout << "Warning: fec_decoder dropped a message that is not a sequence of LDPC codewords!" << std::endl;
+            return;
+        }
+
+        size_t ncw = d_llr.size() / ldpc::N;
+        size_t iterations;
+        d_info.resize(ldpc::info_len(ncw));
+        d_ldpc.decode(d_info.data(), d_llr.data(), ncw, iterations, detected);
+
+        /* The length prefix must fit in the decoded codewords */
+        out_len = ncw ? (d_info[0] << 8) | d_info[1] : 0;
+        if(ncw == 0 || out_len > ncw * ldpc::K / 8 - 2){
+            std::cout << "Warning: fec_decoder dropped an LDPC message with an invalid length!" << std::endl;
+            return;
         }
 
-        for(int i = 0; i < 2 * pdu_len; i++){
-            buffer[i] = (bit_buffer[8 * i] << 7) | (bit_buffer[(8 * i) + 1] << 6) | (bit_buffer[(8 * i) + 2] << 5) | (bit_buffer[(8 * i) + 3] << 4) | (bit_buffer[(8 * i) + 4] << 3) | (bit_buffer[(8 * i) + 5] << 2) | (bit_buffer[(8 * i) + 6] << 1) | (bit_buffer[(8 * i) + 7]);
+        out = pmt::init_u8vector(out_len, d_info.data() + 2);
+        meta = add_stat(meta, "fec_iterations", iterations);
+        meta = add_stat(meta, "fec_uncorrectable", detected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
+        return;
+    }
+    case 8: {
+        /* Do iterative Golay product decoding, Chase-II on soft input */
+        size_t nblocks;
+        size_t iterations;
+        if (bytes_in) {
+            if(pdu_len == 0 || pdu_len % golay_product::BLOCK_BYTES != 0){
+                std::cout << "Warning: fec_decoder dropped a message that is not a sequence of product code blocks!" << std::endl;
+                return;
+            }
+            nblocks = pdu_len / golay_product::BLOCK_BYTES;
+            d_info.resize(nblocks * golay_product::DATA_BYTES);
+            d_product.decode(d_info.data(), bytes_in, nblocks, iterations, detected);
+        }
+        else {
+            if(!to_llr(bytes, d_llr) || d_llr.empty() || d_llr.size() % golay_product::BLOCK_BITS != 0){
+                std::cout << "Warning: fec_decoder dropped a message that is not a sequence of product code blocks!" << std::endl;
+                return;
+            }
+            nblocks = d_llr.size() / golay_product::BLOCK_BITS;
+            d_info.resize(nblocks * golay_product::DATA_BYTES);
+            d_product.decode_soft(d_info.data(), d_llr.data(), nblocks, iterations, detected);
         }
 
-        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, 2 * pdu_len)));
-        
-        delete buffer;
-        delete bit_buffer;
-        delete bits_to_decode;
+        out_len = (d_info[0] << 8) | d_info[1];
+        if(out_len > nblocks * golay_product::DATA_BYTES - 2){
+            std::cout << "Warning: fec_decoder dropped a product code message with an invalid length!" << std::endl;
+            return;
+        }
 
+        out = pmt::init_u8vector(out_len, d_info.data() + 2);
+        meta = add_stat(meta, "fec_iterations", iterations);
+        meta = add_stat(meta, "fec_uncorrectable", detected);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(meta, out));
         return;
+    }
     default:
         throw std::runtime_error("fec_decoder: Invalid FEC");
         return;
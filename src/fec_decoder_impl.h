@@ -22,6 +22,14 @@
 #define INCLUDED_TUTORIAL_FEC_DECODER_IMPL_H
 
 #include <tutorial/fec_decoder.h>
+#include "conv_k7.h"
+#include "golay24.h"
+#include "golay_product.h"
+#include "hamming.h"
+#include "ldpc.h"
+#include "reed_solomon.h"
+#include "repetition.h"
+#include <vector>
 
 namespace gr {
 namespace tutorial {
@@ -29,32 +37,21 @@ namespace tutorial {
 class fec_decoder_impl : public fec_decoder {
 private:
     const int d_type;
-    uint8_t* hamming_lookup;
-    uint8_t* buffer;
-    uint8_t* bit_buffer;
-
-    int u[24] = {};
-    int s[12] = {};
-    int r[24] = {};
-    int P[12][12] = {{1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 1},
-                     {0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 1, 1},
-                     {0, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1},
-                     {0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 1},
-                     {1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1},
-                     {1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1},
-                     {1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1},
-                     {0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 1},
-                     {1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1},
-                     {1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1},
-                     {0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
-                     {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0}};
-    int** G;
-    int** HT;
+    repetition d_repetition;
+    golay24 d_golay;
+    hamming d_hamming;
+    conv_k7 d_conv;
+    reed_solomon d_rs;
+    ldpc d_ldpc;
+    golay_product d_product;
+    /* Buffers of the LDPC and product decoders, reused across PDUs */
+    std::vector<int8_t> d_llr;
+    std::vector<uint8_t> d_info;
 
     void decode(pmt::pmt_t m);
 
 public:
-    fec_decoder_impl(int type);
+    fec_decoder_impl(int type, size_t rs_block_len, bool golay_bitsliced);
     ~fec_decoder_impl();
 
 };
@@ -29,21 +29,22 @@ namespace gr {
 namespace tutorial {
 
 fec_encoder::sptr
-fec_encoder::make(int type)
+fec_encoder::make(int type, size_t rs_block_len)
 {
     return gnuradio::get_initial_sptr
-           (new fec_encoder_impl(type));
+           (new fec_encoder_impl(type, rs_block_len));
 }
 
 
 /*
  * The private constructor
  */
-fec_encoder_impl::fec_encoder_impl(int type)
+fec_encoder_impl::fec_encoder_impl(int type, size_t rs_block_len)
     : gr::block("fec_encoder",
                 gr::io_signature::make(0, 0, 0),
                 gr::io_signature::make(0, 0, 0)),
-      d_type(type)
+      d_type(type),
+      d_rs(rs_block_len)
 {
     message_port_register_in(pmt::mp("pdu_in"));
     message_port_register_out(pmt::mp("pdu_out"));
@@ -56,46 +57,6 @@ fec_encoder_impl::fec_encoder_impl(int type)
     [this](pmt::pmt_t msg) {
         this->fec_encoder_impl::encode(msg);
     });
-
-    if(type == 2){
-        G = new int*[12];
-        HT = new int*[24];
-
-        for (int i = 0; i < 12; ++i) {
-            G[i] = new int[24];
-        }
-
-        for (int i = 0; i < 24; ++i) {
-            HT[i] = new int[12];
-        }
-
-        for (int i = 0; i < 24; ++i) {
-            u[i] = 0;
-        }
-
-        int I[12][12];
-        for (int i = 0; i < 12; i++) {
-            for (int j = 0; j < 12; j++) {
-                if (i == j) {
-                    I[i][j] = 1;
-                } else {
-                    I[i][j] = 0;
-                }
-            }
-        }
-
-        for (int i = 0; i < 12; i++) {
-            for (int j = 0; j < 24; j++) {
-                if (j < 12) {
-                    HT[j][i] = I[i][j];
-                    G[i][j] = P[i][j];
-                } else {
-                    G[i][j] = I[i][j - 12];
-                    HT[j][i] = P[i][j - 12];
-                }
-            }
-        }
-    }
 }
 
 /*
@@ -103,19 +64,6 @@ fec_encoder_impl::fec_encoder_impl(int type)
  */
 fec_encoder_impl::~fec_encoder_impl()
 {
-    if(d_type == 2){
-        for (int i = 0; i < 12; ++i) {
-            delete G[i];
-        }
-
-        delete G;
-
-        for (int i = 0; i < 24; ++i) {
-            delete HT[i];
-        }
-
-        delete HT;
-    }
 }
 
 void
@@ -127,10 +75,8 @@ fec_encoder_impl::encode(pmt::pmt_t m)
 
     size_t pdu_len;
     const uint8_t *bytes_in = pmt::u8vector_elements(bytes, pdu_len);
-    uint8_t bit_in;
-    uint8_t *bits_to_encode;
-    size_t bits_to_encode_index = 0;
-    size_t bit_buffer_index = 0;
+    pmt::pmt_t out;
+    size_t out_len;
 
     switch (d_type) {
     /* No FEC just copy the input message to the output */
@@ -138,27 +84,11 @@ fec_encoder_impl::encode(pmt::pmt_t m)
         message_port_pub(pmt::mp("pdu_out"), m);
         return;
     case 1:
-        /* Do Hamming encoding */
-        buffer = new uint8_t[3 * pdu_len];
-        bit_buffer = new uint8_t[3 * pdu_len * 8];
-
-        for(int i = 0; i < pdu_len; i++){
-            for(int j = 7; j >= 0; j--){
-                bit_in = ((bytes_in[i] >> j) & 1);
-                bit_buffer[(24 * i) + (3 * j)] = bit_in;
-                bit_buffer[(24 * i) + (3 * j) + 1] = bit_in;
-                bit_buffer[(24 * i) + (3 * j) + 2] = bit_in;
-            }
-        }
-        
-        for(int i = 0; i < 3 * pdu_len; i++){
-            buffer[i] = (bit_buffer[8 * i] << 7) | (bit_buffer[(8 * i) + 1] << 6) | (bit_buffer[(8 * i) + 2] << 5) | (bit_buffer[(8 * i) + 3] << 4) | (bit_buffer[(8 * i) + 4] << 3) | (bit_buffer[(8 * i) + 5] << 2) | (bit_buffer[(8 * i) + 6] << 1) | (bit_buffer[(8 * i) + 7]);
-        }
+        /* Do repetition encoding, every bit sent three times */
+        out = pmt::make_u8vector(3 * pdu_len, 0);
+        d_repetition.encode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
 
-        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, 3 * pdu_len)));
-
-        delete buffer;
-        delete bit_buffer;
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
         return;
     case 2:
         /* Do Golay encoding */
@@ -167,36 +97,61 @@ fec_encoder_impl::encode(pmt::pmt_t m)
             return;
         }
 
-        buffer = new uint8_t[2 * pdu_len];
-        bit_buffer = new uint8_t[2 * pdu_len * 8];
-        bits_to_encode = new uint8_t[12];
-
-        for(int i = 0; i < pdu_len; i++){
-            for(int j = 0; j < 8; j++){
-                bits_to_encode[bits_to_encode_index] = (bytes_in[i] & (1 << (7 - j))) >> (7 - j);
-                bits_to_encode_index++;
-                if(bits_to_encode_index == 12){
-                    for (int k = 0; k < 24; k++) {
-                        for (int l = 0; l < 12; l++) {
-                            u[k] = (u[k] + (bits_to_encode[l] * G[l][k])) % 2;
-                        }
-                        bit_buffer[bit_buffer_index] = u[k];
-                        bit_buffer_index++;
-                    }
-                    bits_to_encode_index = 0;
-                }
-            }
+        /* Encode straight into the PDU, two codewords per 3 input bytes */
+        out = pmt::make_u8vector(2 * pdu_len, 0);
+        d_golay.encode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 3:
+        /* Do Hamming(7,4) encoding, codewords packed back to back */
+        out = pmt::make_u8vector(hamming::encoded_len_74(pdu_len), 0);
+        d_hamming.encode_74(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 4:
+        /* Do Hamming(8,4) SECDED encoding, one codeword per nibble */
+        out = pmt::make_u8vector(2 * pdu_len, 0);
+        d_hamming.encode_84(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 5:
+        /* Do K=7 rate 1/2 convolutional encoding, zero tail terminated */
+        out = pmt::make_u8vector(conv_k7::encoded_len(pdu_len), 0);
+        d_conv.encode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 6:
+        /* Do RS(255,223) encoding in blocks of rs_block_len, the last one shortened to fit */
+        out = pmt::make_u8vector(d_rs.encoded_len(pdu_len), 0);
+        d_rs.encode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
+
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 7:
+        /* Do LDPC encoding, length prefixed and padded to whole codewords */
+        if(pdu_len > ldpc::MAX_LEN){
+            std::cout << "Warning: fec_encoder dropped a message too long for its LDPC length prefix!" << std::endl;
+            return;
         }
+        out = pmt::make_u8vector(d_ldpc.encoded_len(pdu_len), 0);
+        d_ldpc.encode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
 
-        for(int i = 0; i < 2 * pdu_len; i++){
-            buffer[i] = (bit_buffer[8 * i] << 7) | (bit_buffer[(8 * i) + 1] << 6) | (bit_buffer[(8 * i) + 2] << 5) | (bit_buffer[(8 * i) + 3] << 4) | (bit_buffer[(8 * i) + 4] << 3) | (bit_buffer[(8 * i) + 5] << 2) | (bit_buffer[(8 * i) + 6] << 1) | (bit_buffer[(8 * i) + 7]);
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
+        return;
+    case 8:
+        /* Do Golay product encoding, length prefixed like LDPC */
+        if(pdu_len > golay_product::MAX_LEN){
+            std::cout << "Warning: fec_encoder dropped a message too long for its Golay product length prefix!" << std::endl;
+            return;
         }
+        out = pmt::make_u8vector(d_product.encoded_len(pdu_len), 0);
+        d_product.encode(pmt::u8vector_writable_elements(out, out_len), bytes_in, pdu_len);
 
-        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, 2 * pdu_len)));
-        
-        delete buffer;
-        delete bit_buffer;
-        delete bits_to_encode;
+        message_port_pub(pmt::mp("pdu_out"), pmt::cons(pmt::PMT_NIL, out));
         return;
     default:
         throw std::runtime_error("fec_encoder: Invalid FEC");
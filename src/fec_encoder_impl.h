@@ -22,6 +22,13 @@
 #define INCLUDED_TUTORIAL_FEC_ENCODER_IMPL_H
 
 #include <tutorial/fec_encoder.h>
+#include "conv_k7.h"
+#include "golay24.h"
+#include "golay_product.h"
+#include "hamming.h"
+#include "ldpc.h"
+#include "reed_solomon.h"
+#include "repetition.h"
 
 namespace gr {
 namespace tutorial {
@@ -29,29 +36,18 @@ namespace tutorial {
 class fec_encoder_impl : public fec_encoder {
 private:
     const int d_type;
-    uint8_t* buffer;
-    uint8_t* bit_buffer;
-
-    int u[24];
-    int P[12][12] = {{1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 1},
-                     {0, 0, 0, 1, 1, 1, 0, 1, 1, 0, 1, 1},
-                     {0, 0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 1},
-                     {0, 1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 1},
-                     {1, 1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1},
-                     {1, 1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1},
-                     {1, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1},
-                     {0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 1},
-                     {1, 1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1},
-                     {1, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1},
-                     {0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
-                     {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0}};
-    int** G;
-    int** HT;
+    repetition d_repetition;
+    golay24 d_golay;
+    hamming d_hamming;
+    conv_k7 d_conv;
+    reed_solomon d_rs;
+    ldpc d_ldpc;
+    golay_product d_product;
 
     void encode(pmt::pmt_t m);
 
 public:
-    fec_encoder_impl(int type);
+    fec_encoder_impl(int type, size_t rs_block_len);
     ~fec_encoder_impl();
 
 };
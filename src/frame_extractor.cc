@@ -0,0 +1,213 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "frame_extractor.h"
+#include "frame_sync_impl.h"
+#include "psk.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gr {
+namespace tutorial {
+
+/* Items handed to the state machine per call, as a scheduler would */
+static const size_t block_items = 1 << 16;
+
+/* Smallest segment worth a frame_sync of its own */
+static const size_t min_segment = 1 << 20;
+
+frame_extractor::frame_extractor(uint8_t preamble, uint8_t preamble_len,
+                                 const std::vector<uint8_t> &sync_word,
+                                 int mod, int input_format, bool differential,
+                                 double false_alarm_rate, int header_format,
+                                 int max_contexts, size_t nsync_words,
+                                 int nthreads)
+    : d_preamble(preamble),
+      d_preamble_len(preamble_len),
+      d_sync_word(sync_word),
+      d_mod(mod),
+      d_input_format(input_format),
+      d_differential(differential),
+      d_false_alarm_rate(false_alarm_rate),
+      d_header(header_format),
+      d_max_contexts(max_contexts),
+      d_nsync_words(std::max(nsync_words, (size_t) 1))
+{
+    if(nthreads < 0){
+        throw std::invalid_argument("frame_extractor: Invalid number of threads");
+    }
+    d_nthreads = nthreads > 0 ? nthreads : std::thread::hardware_concurrency();
+    d_nthreads = std::max(d_nthreads, (size_t) 1);
+
+    /* Also checks the arguments */
+    frame_sync_impl probe(preamble, preamble_len, sync_word, mod, input_format,
+                          differential, false_alarm_rate, header_format,
+                          max_contexts, nsync_words, 1, 1, 0);
+
+    d_item_bits = (input_format == correlator::PACKED) ? 8 : 1;
+    /*
+     * Segments start on symbol boundaries, so the differential decoder
+     * groups the bits into symbols as a single pass would
+     */
+    d_bps = psk::bits_per_symbol(mod);
+    /* A few symbols more for the differential decoder to settle */
+    size_t lead = 8 * (preamble_len + sync_word.size() / d_nsync_words) + 16;
+    d_lead = (lead + d_item_bits - 1) / d_item_bits;
+    d_lead = (d_lead + d_bps - 1) / d_bps * d_bps;
+    d_overlap = (probe.max_frame_len() + d_item_bits - 1) / d_item_bits;
+}
+
+size_t
+frame_extractor::item_size() const
+{
+    return d_input_format == correlator::FLOAT ? sizeof(float) : sizeof(uint8_t);
+}
+
+/*
+ * Searches the items of [start, end) with the lead before and the
+ * overlap after them, and keeps the frames whose sync word ends in
+ * [start, end)
+ */
+void
+frame_extractor::segment(const uint8_t *in, size_t nitems, size_t start,
+                         size_t end, std::vector<frame> &frames) const
+{
+    frame_sync_impl fs(d_preamble, d_preamble_len, d_sync_word, d_mod,
+                       d_input_format, d_differential, d_false_alarm_rate,
+                       d_header, d_max_contexts, d_nsync_words, 1, 1, 0);
+    size_t from = start > d_lead ? start - d_lead : 0;
+    size_t to = std::min(nitems, end + d_overlap);
+    std::vector<pmt::pmt_t> pdus;
+    for(size_t i = from; i < to; i += block_items){
+        size_t n = std::min(block_items, to - i);
+        fs.run(in + i * item_size(), n, pdus);
+    }
+
+    const pmt::pmt_t key = pmt::mp("stream_offset");
+    for(const pmt::pmt_t &pdu : pdus){
+        uint64_t offset = from * d_item_bits
+                          + pmt::to_uint64(pmt::dict_ref(pmt::car(pdu), key,
+                                                         pmt::PMT_NIL));
+        if(offset >= start * d_item_bits && offset < end * d_item_bits){
+            pmt::pmt_t meta = pmt::dict_add(pmt::car(pdu), key,
+                                            pmt::from_uint64(offset));
+            frames.push_back({offset, pmt::cons(meta, pmt::cdr(pdu))});
+        }
+    }
+    /* Frames of different lengths may end out of order */
+    std::stable_sort(frames.begin(), frames.end(),
+                     [](const frame &a, const frame &b){
+                         return a.offset < b.offset;
+                     });
+}
+
+std::vector<frame_extractor::frame>
+frame_extractor::extract(const void *in, size_t nitems) const
+{
+    /* A few segments per thread, to even out their load */
+    size_t seg = (nitems + 4 * d_nthreads - 1) / (4 * d_nthreads);
+    seg = std::max(seg, std::max(min_segment, 4 * (d_lead + d_overlap)));
+    seg = (seg + d_bps - 1) / d_bps * d_bps;
+    size_t nseg = std::max((nitems + seg - 1) / seg, (size_t) 1);
+
+    std::vector<std::vector<frame>> found(nseg);
+    std::atomic<size_t> next(0);
+    auto worker = [&](){
+        for(size_t s = next++; s < nseg; s = next++){
+            segment((const uint8_t *) in, nitems, s * seg,
+                    std::min(nitems, (s + 1) * seg), found[s]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < std::min(d_nthreads, nseg); i++){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(std::thread &t : threads){
+        t.join();
+    }
+
+    /* Frames are numbered anew, across the whole capture */
+    std::vector<frame> frames;
+    const pmt::pmt_t key = pmt::mp("frame_id");
+    for(std::vector<frame> &f : found){
+        for(frame &fr : f){
+            pmt::pmt_t meta = pmt::dict_add(pmt::car(fr.pdu), key,
+                                            pmt::from_uint64(frames.size()));
+            frames.push_back({fr.offset, pmt::cons(meta, pmt::cdr(fr.pdu))});
+        }
+    }
+    return frames;
+}
+
+std::vector<frame_extractor::frame>
+frame_extractor::extract(const std::string &path) const
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw std::runtime_error("frame_extractor: " + path + ": "
+                                 + std::strerror(errno));
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0){
+        int err = errno;
+        close(fd);
+        throw std::runtime_error("frame_extractor: " + path + ": "
+                                 + std::strerror(err));
+    }
+    size_t len = st.st_size;
+    if(len == 0){
+        close(fd);
+        return std::vector<frame>();
+    }
+    void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if(p == MAP_FAILED){
+        throw std::runtime_error("frame_extractor: " + path + ": "
+                                 + std::strerror(err));
+    }
+    madvise(p, len, MADV_SEQUENTIAL);
+
+    std::vector<frame> frames;
+    try{
+        frames = extract(p, len / item_size());
+    }
+    catch(...){
+        munmap(p, len);
+        throw;
+    }
+    munmap(p, len);
+    return frames;
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
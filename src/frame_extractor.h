@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_FRAME_EXTRACTOR_H
+#define INCLUDED_TUTORIAL_FRAME_EXTRACTOR_H
+
+#include <pmt/pmt.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Offline counterpart of the frame_sync block. It runs the frame_sync
+ * state machine over a recorded capture, split into segments that are
+ * searched in parallel.
+ *
+ * Each segment starts a little before its own range, long enough for
+ * a preamble and sync word, and goes on one frame past its end. It
+ * keeps only the frames whose sync word ends inside its own range, so
+ * a frame found twice in an overlap is kept by one segment only.
+ */
+class frame_extractor {
+public:
+    /* A frame and the position in the capture where its sync word ended */
+    struct frame {
+        uint64_t offset;
+        pmt::pmt_t pdu;
+    };
+
+    /* The arguments are those of frame_sync, for a single channel */
+    frame_extractor(uint8_t preamble, uint8_t preamble_len,
+                    const std::vector<uint8_t> &sync_word,
+                    int mod, int input_format, bool differential,
+                    double false_alarm_rate, int header_format,
+                    int max_contexts, size_t nsync_words,
+                    int nthreads = 0);
+
+    /* Frames in nitems input items, in capture order */
+    std::vector<frame> extract(const void *in, size_t nitems) const;
+
+    /* The same for a capture file, which is memory-mapped */
+    std::vector<frame> extract(const std::string &path) const;
+
+    /* Bytes per input item */
+    size_t item_size() const;
+
+private:
+    const uint8_t d_preamble;
+    const uint8_t d_preamble_len;
+    const std::vector<uint8_t> d_sync_word;
+    const int d_mod;
+    const int d_input_format;
+    const bool d_differential;
+    const double d_false_alarm_rate;
+    const int d_header;
+    const int d_max_contexts;
+    const size_t d_nsync_words;
+    size_t d_nthreads;
+    /* Positions per input item */
+    size_t d_item_bits;
+    size_t d_bps;
+    /* Items before a segment for a sync word and after it for a frame */
+    size_t d_lead;
+    size_t d_overlap;
+
+    void segment(const uint8_t *in, size_t nitems, size_t start, size_t end,
+                 std::vector<frame> &frames) const;
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_FRAME_EXTRACTOR_H */
@@ -0,0 +1,102 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "frame_header.h"
+#include "crc.h"
+
+namespace gr {
+namespace tutorial {
+namespace frame_header {
+
+size_t
+size(int format)
+{
+    switch(format){
+        case CRC8:
+            return 3;
+        case CRC16:
+            return 4;
+        case GOLAY:
+            return 6;
+        default:
+            return 2;
+    }
+}
+
+void
+encode(uint8_t *out, int format, uint16_t len, const golay24 &golay)
+{
+    uint8_t h[3] = {(uint8_t)(len >> 8), (uint8_t) len, 0};
+    uint16_t c;
+
+    switch(format){
+        case CRC8:
+        case GOLAY:
+            h[2] = crc::crc8(h, 2);
+            if(format == GOLAY){
+                golay.encode(out, h, 3);
+                return;
+            }
+            out[2] = h[2];
+            break;
+        case CRC16:
+            c = crc::crc16(h, 2);
+            out[2] = c >> 8;
+            out[3] = c;
+            break;
+        default:
+            break;
+    }
+    out[0] = h[0];
+    out[1] = h[1];
+}
+
+bool
+decode(const uint8_t *in, int format, const golay24 &golay, uint16_t &len)
+{
+    uint8_t h[3];
+
+    switch(format){
+        case CRC8:
+            len = (in[0] << 8) | in[1];
+            return crc::crc8(in, 2) == in[2];
+        case CRC16:
+            len = (in[0] << 8) | in[1];
+            return crc::crc16(in, 2) == ((in[2] << 8) | in[3]);
+        case GOLAY:
+            /* Corrected codewords still have to agree with the CRC */
+            if(golay.decode(h, in, 6)){
+                return false;
+            }
+            len = (h[0] << 8) | h[1];
+            return crc::crc8(h, 2) == h[2];
+        default:
+            len = (in[0] << 8) | in[1];
+            return true;
+    }
+}
+
+} // namespace frame_header
+} /* namespace tutorial */
+} /* namespace gr */
@@ -0,0 +1,69 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_FRAME_HEADER_H
+#define INCLUDED_TUTORIAL_FRAME_HEADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "golay24.h"
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * The frame header after the sync word, shared by the framer and the frame
+ * synchronizer. It holds the 16-bit big endian payload length, either as
+ * is or protected, so that a false lock is told apart from a frame within
+ * a few bytes:
+ *
+ *  RAW    the length, 2 bytes
+ *  CRC8   the length and its CRC-8, 3 bytes
+ *  CRC16  the length and its CRC-16, 4 bytes
+ *  GOLAY  the 3 bytes of CRC8 as two Golay(24,12) codewords, 6 bytes
+ */
+namespace frame_header {
+
+typedef enum {
+    RAW,
+    CRC8,
+    CRC16,
+    GOLAY
+} format_t;
+
+/* Bytes of a header */
+size_t size(int format);
+
+/* Writes the header for a payload of len bytes to out */
+void encode(uint8_t *out, int format, uint16_t len, const golay24 &golay);
+
+/*
+ * Reads the payload length from a received header. Returns false if the
+ * header does not check.
+ */
+bool decode(const uint8_t *in, int format, const golay24 &golay,
+            uint16_t &len);
+
+} // namespace frame_header
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_FRAME_HEADER_H */
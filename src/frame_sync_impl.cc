@@ -24,17 +24,86 @@
 
 #include <gnuradio/io_signature.h>
 #include "frame_sync_impl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace gr {
 namespace tutorial {
 
+/* log of the probability of k errors in n bits at error rate p */
+static double
+log_binomial(size_t n, size_t k, double p)
+{
+    return std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0)
+           + k * std::log(p) + (n - k) * std::log1p(-p);
+}
+
+/*
+ * The most mismatches with which npatterns patterns of n bits match
+ * random bits at a window position with probability at most rate
+ */
+static size_t
+max_threshold(size_t n, size_t npatterns, double rate)
+{
+    double p = 0.0;
+    for(size_t t = 0; t <= n; t++){
+        p += npatterns * std::exp(log_binomial(n, t, 0.5));
+        if(p > rate){
+            return t ? t - 1 : 0;
+        }
+    }
+    return n;
+}
+
+/*
+ * The fewest mismatches that n bits at bit error rate ber exceed with
+ * probability at most miss
+ */
+static size_t
+miss_threshold(size_t n, double ber, double miss)
+{
+    double p = 0.0;
+    for(size_t t = 0; t < n; t++){
+        p += std::exp(log_binomial(n, t, ber));
+        if(1.0 - p <= miss){
+            return t;
+        }
+    }
+    return n;
+}
+
+/* Adds a statistic to the metadata of a PDU */
+static pmt::pmt_t
+add_stat(pmt::pmt_t meta, const char *key, size_t value)
+{
+    if (!pmt::is_dict(meta)) {
+        meta = pmt::make_dict();
+    }
+    return pmt::dict_add(meta, pmt::mp(key), pmt::from_uint64(value));
+}
+
 frame_sync::sptr
 frame_sync::make(uint8_t preamble, uint8_t preamble_len,
                  const std::vector<uint8_t> &sync_word,
-                 int mod)
+                 int mod, int input_format, bool differential,
+                 double false_alarm_rate, int header_format,
+                 int max_contexts, size_t nsync_words,
+                 int nchannels, int nthreads, size_t chunk_size)
 {
     return gnuradio::get_initial_sptr
-           (new frame_sync_impl(preamble, preamble_len, sync_word, mod));
+           (new frame_sync_impl(preamble, preamble_len, sync_word, mod,
+                                input_format, differential,
+                                false_alarm_rate, header_format,
+                                max_contexts, nsync_words,
+                                nchannels, nthreads, chunk_size));
 }
 
 
@@ -43,124 +112,196 @@ frame_sync::make(uint8_t preamble, uint8_t preamble_len,
  */
 frame_sync_impl::frame_sync_impl(uint8_t preamble, uint8_t preamble_len,
                                  const std::vector<uint8_t> &sync_word,
-                                 int mod)
+                                 int mod, int input_format, bool differential,
+                                 double false_alarm_rate, int header_format,
+                                 int max_contexts, size_t nsync_words,
+                                 int nchannels, int nthreads, size_t chunk_size)
     : gr::sync_block("frame_sync",
-                    gr::io_signature::make(1, 1, sizeof(uint8_t)),
+                    gr::io_signature::make(std::max(nchannels, 1), std::max(nchannels, 1),
+                                           input_format == correlator::FLOAT ?
+                                           sizeof(float) : sizeof(uint8_t)),
                     gr::io_signature::make(0, 0, 0)),
                     d_mod((mod_t)mod),
+                    d_bps(psk::bits_per_symbol(mod)),
+                    d_format((correlator::format_t)input_format),
+                    d_differential(differential),
+                    d_stream((differential && input_format == correlator::UNPACKED) ?
+                             correlator::PACKED : (correlator::format_t)input_format),
+                    d_preamble_corr(preamble_len * 4),
+                    d_nsync_words(std::max(nsync_words, (size_t) 1)),
+                    d_FSD_corr(sync_word.size() / d_nsync_words * 8 / d_bps * d_bps),
+                    d_nrot(differential ? 1 : 1 << d_bps),
+                    d_false_alarm_rate(false_alarm_rate),
+                    d_header(header_format),
+                    d_chunk_size(chunk_size),
                     d_preamble(preamble),
                     d_preamble_len(preamble_len),
-                    d_sync_word(sync_word)
+                    d_sync_word(sync_word),
+                    d_nthreads(nthreads)
 {
+    if(sync_word.size() % d_nsync_words){
+        throw std::invalid_argument("frame_sync: Invalid sync words");
+    }
     message_port_register_out(pmt::mp("pdu"));
 
-    d_FSD_len = sync_word.size();
-
-    stream = new shift_reg(preamble_len * 4);
-    preamble_lookup = new shift_reg(preamble_len * 4); //besicaly (preamble_len / 2) * 8
-    FSD_lookup = new shift_reg(d_FSD_len * 8);
-    FSD_lookup_90 = new shift_reg(d_FSD_len * 8);
-    FSD_lookup_180 = new shift_reg(d_FSD_len * 8);
-    FSD_lookup_270 = new shift_reg(d_FSD_len * 8);
+    d_FSD_len = sync_word.size() / d_nsync_words;
     max_size = 3 * 2048;
 
-    byteBuffer = new uint8_t[8];
-    buffer = new uint8_t[max_size];
-
-    stream->reset();
-    preamble_lookup->reset();
-    FSD_lookup->reset();
-    FSD_lookup_90->reset();
-    FSD_lookup_180->reset();
-    FSD_lookup_270->reset();
+    d_head_bits = d_FSD_len * 8 - d_FSD_corr.len() + 8 * frame_header::size(d_header);
 
-    for(int i = 0; i < preamble_len / 2; i++){
-        for(int j = 0; j < 8; j++){
-            *preamble_lookup >>= ((preamble & (1 << j)) >> j);
+    /* Label rotation tables from the constellation labels */
+    const int M = 1 << d_bps;
+    for(int k = 0; k < M; k++){
+        d_label[k] = psk::label(d_mod, k);
+        for(int l = 0; l < M; l++){
+            uint8_t r = psk::label(d_mod, psk::phase(d_mod, l) + k);
+            d_rot[k][l] = r;
+            d_derot[k][r] = l;
+            d_diff_table[l][r] = d_label[k];
         }
     }
-
-    for(int i = 0; i < sync_word.size(); i++){
-        for(int j = 0; j < 8; j++){
-            *FSD_lookup >>= ((sync_word[sync_word.size() - i - 1] & (1 << j)) >> j);
+    for(int p = 0; p < 4; p++){
+        for(int m = 0; m < 256; m++){
+            uint8_t r = 0;
+            int prev = p % M;
+            if(d_bps < 3){
+                for(int j = 8 - d_bps; j >= 0; j -= d_bps){
+                    int l = (m >> j) & (M - 1);
+                    r |= d_diff_table[prev][l] << j;
+                    prev = l;
+                }
+            }
+            d_diff_bytes[p][m] = r;
         }
     }
 
-    for(int i = 0; i < sync_word.size(); i++){
-        for(int j = 0; j < 8; j += 2){
-            if((sync_word[sync_word.size() - i - 1] & (1 << j)) >> j){
-                if((sync_word[sync_word.size() - i - 1] & (1 << (j + 1))) >> (j + 1)){
-                    *FSD_lookup_90 >>= 0;
-                    *FSD_lookup_90 >>= 0;
-                }else{
-                    *FSD_lookup_90 >>= 0;
-                    *FSD_lookup_90 >>= 1;
+    /*
+     * The preamble pattern is preamble_len / 2 copies of the preamble
+     * byte, MSB first, padded with zeros to preamble_len * 4 bits
+     */
+    std::vector<uint8_t> bits(preamble_len * 4, 0);
+    for(int i = 0; i < (preamble_len / 2) * 8; i++){
+        bits[i] = (preamble >> (7 - i % 8)) & 1;
+    }
+    d_preamble_corr.add_pattern(bits);
+
+    /*
+     * Every sync word MSB first, as sent and for every rotation, which a
+     * differential mapping does not need. Pattern c * d_nrot + k is sync
+     * word c rotated by k.
+     */
+    for(size_t c = 0; c < d_nsync_words; c++){
+        const uint8_t *word = &sync_word[c * d_FSD_len];
+        bits.assign(d_FSD_corr.len(), 0);
+        for(size_t i = 0; i < bits.size(); i++){
+            bits[i] = (word[i / 8] >> (7 - i % 8)) & 1;
+        }
+        for(int k = 0; k < d_nrot; k++){
+            std::vector<uint8_t> rotated(bits.size());
+            for(size_t i = 0; i < bits.size(); i += d_bps){
+                int l = 0;
+                for(int j = 0; j < d_bps; j++){
+                    l = (l << 1) | bits[i + j];
                 }
-            }else{
-                if((sync_word[sync_word.size() - i - 1] & (1 << (j + 1))) >> (j + 1)){
-                    *FSD_lookup_90 >>= 1;
-                    *FSD_lookup_90 >>= 1;
-                }else{
-                    *FSD_lookup_90 >>= 1;
-                    *FSD_lookup_90 >>= 0;
+                l = d_rot[k][l];
+                for(int j = 0; j < d_bps; j++){
+                    rotated[i + j] = (l >> (d_bps - 1 - j)) & 1;
                 }
             }
+            d_FSD_corr.add_pattern(rotated);
         }
     }
 
-    for(int i = 0; i < sync_word.size(); i++){
-        for(int j = 0; j < 8; j += 2){
-            if((sync_word[sync_word.size() - i - 1] & (1 << j)) >> j){
-                if((sync_word[sync_word.size() - i - 1] & (1 << (j + 1))) >> (j + 1)){
-                    *FSD_lookup_180 >>= 1;
-                    *FSD_lookup_180 >>= 0;
-                }else{
-                    *FSD_lookup_180 >>= 1;
-                    *FSD_lookup_180 >>= 1;
+    /*
+     * Payload packing tables. BPSK and QPSK symbols fit in a byte, so the
+     * tables also turn them back by the rotation the sync word was found
+     * with. 8PSK bytes are only packed and turned back 3 at a time.
+     */
+    for(int t = 0; t < 4; t++){
+        for(int m = 0; m < 256; m++){
+            uint8_t b = 0;
+            for(int j = 0; j < 8; j++){
+                b |= ((m >> j) & 1) << (7 - j);
+            }
+            if(d_bps < 3){
+                uint8_t r = 0;
+                for(int j = 0; j < 8; j += d_bps){
+                    r |= d_derot[t % M][(b >> j) & (M - 1)] << j;
                 }
-            }else{
-                if((sync_word[sync_word.size() - i - 1] & (1 << (j + 1))) >> (j + 1)){
-                    *FSD_lookup_180 >>= 0;
-                    *FSD_lookup_180 >>= 0;
-                }else{
-                    *FSD_lookup_180 >>= 0;
-                    *FSD_lookup_180 >>= 1;
+                b = r;
+            }
+            d_pack_table[t][m] = b;
+        }
+        for(int m = 0; m < 256; m++){
+            uint8_t r = 0;
+            for(int j = 0; j < 8; j++){
+                r |= ((m >> j) & 1) << (7 - j);
+            }
+            d_byte_table[t][m] = d_pack_table[t][r];
+        }
+    }
+    if(d_mod == PSK8){
+        d_group_table.resize(8 * 4096);
+        for(int k = 0; k < 8; k++){
+            for(int m = 0; m < 4096; m++){
+                uint16_t r = 0;
+                for(int j = 0; j < 12; j += 3){
+                    r |= d_derot[k][(m >> j) & 0x7] << j;
                 }
+                d_group_table[k * 4096 + m] = r;
             }
         }
     }
 
-    for(int i = 0; i < sync_word.size(); i++){
-        for(int j = 0; j < 8; j += 2){
-            if((sync_word[sync_word.size() - i - 1] & (1 << j)) >> j){
-                if((sync_word[sync_word.size() - i - 1] & (1 << (j + 1))) >> (j + 1)){
-                    *FSD_lookup_270 >>= 0;
-                    *FSD_lookup_270 >>= 1;
-                }else{
-                    *FSD_lookup_270 >>= 0;
-                    *FSD_lookup_270 >>= 0;
-                }
-            }else{
-                if((sync_word[sync_word.size() - i - 1] & (1 << (j + 1))) >> (j + 1)){
-                    *FSD_lookup_270 >>= 1;
-                    *FSD_lookup_270 >>= 0;
-                }else{
-                    *FSD_lookup_270 >>= 1;
-                    *FSD_lookup_270 >>= 1;
-                }
+    d_preamble_max = (d_preamble_len * 4) / 10;
+    d_FSD_max = d_FSD_len;
+    if(d_false_alarm_rate > 0){
+        d_preamble_max = max_threshold(d_preamble_corr.len(), 1, d_false_alarm_rate);
+        d_FSD_max = max_threshold(d_FSD_corr.len(), d_nsync_words * d_nrot,
+                                  d_false_alarm_rate);
+    }
+
+    /*
+     * Every channel starts out searching with the largest thresholds. All
+     * the memory of its frames is taken here, for the largest ones.
+     */
+    d_channels.reserve(std::max(nchannels, 1));
+    for(int i = 0; i < std::max(nchannels, 1); i++){
+        d_channels.emplace_back(d_preamble_corr, d_FSD_corr);
+        channel_t &c = d_channels.back();
+        c.preamble_threshold = d_preamble_max;
+        c.FSD_threshold = d_FSD_max;
+        c.errors = 0.0;
+        c.error_bits = 0.0;
+        c.locks = 0;
+        c.false_locks = 0;
+        c.frame_id = 0;
+        c.offset = 0;
+        c.state = PREAMBLE_SEARCH;
+        c.allowed_mistakes = c.preamble_threshold;
+        c.data_received = 0;
+        c.frames.resize(std::max(max_contexts, 1));
+        for(frame_t &f : c.frames){
+            /* Room to pad the last group of 3 8PSK bytes */
+            f.buffer.resize(frame_bytes(d_head_bits + 8 * max_size) + 3);
+            if(d_format == correlator::FLOAT){
+                f.soft.resize(frame_values(d_head_bits + 8 * max_size));
+            }else if(d_format == correlator::INT8){
+                f.soft8.resize(frame_values(d_head_bits + 8 * max_size));
             }
         }
+        c.busy.reserve(c.frames.size());
+        c.diff_prev = 0;
+        std::fill_n(c.diff_prev_llr, 3, 0.0f);
+        c.diff_carry_len = 0;
     }
 
-    state = PREAMBLE_SEARCH;
-    allowed_mistakes = (d_preamble_len * 4) / 10;
-    data_received = 0;
-    byteBufferIntex = 0;
-    bufferIntex = 0;
-    BPSK_inversed = false;
-    rotation = R_0;
-    saved_bit = 0;
-    has_save_bit = false;
+    d_batch = 0;
+    d_stop = false;
+    d_next = 0;
+    d_pending = 0;
+    d_batch_in = NULL;
+    d_batch_items = 0;
 }
 
 /*
@@ -168,194 +309,814 @@ frame_sync_impl::frame_sync_impl(uint8_t preamble, uint8_t preamble_len,
  */
 frame_sync_impl::~frame_sync_impl()
 {
-    if(stream)
-        delete stream;
-    delete preamble_lookup;
-    delete FSD_lookup;
-    delete byteBuffer;
-    delete buffer;
+    stop();
 }
 
-int
-frame_sync_impl::work(int noutput_items,
-                      gr_vector_const_void_star &input_items,
-                      gr_vector_void_star &output_items)
+/*
+ * Packs nbytes * 8 input bits, one per byte, into nbytes bytes through
+ * table, which maps the 8 bits of a byte, the first one in the LSB, to the
+ * output byte.
+ */
+static void
+pack_bits(uint8_t *out, const uint8_t *in, size_t nbytes, const uint8_t table[256])
 {
-    const uint8_t* in = (const uint8_t *) input_items[0];
+    size_t i = 0;
 
-    // Do <+signal processing+>
-    /*
-     * GNU Radio handles PMT messages in a pair structure.
-     * The first element corresonds to possible metadata (in our case we do not
-     * have assosiated metadata) whereas the second element contains the
-     * data in a vector of uint8_t.
-     *
-     * When the frame is extracted, you will possible hold it in a *uint8_t buffer,
-     * To create a PMT pair message you can use:
-     * pmt::pmt_t pair = pmt::cons(pmt::PMT_NIL, pmt::init_u8vector(frame_len, buf));
-     *
-     * Then you can send this message to the port we have registered at the contructpr
-     * using:
-     *
-     * message_port_pub(pmt::mp("pdu"), pair);
-     */
-    for(int count = 0; count < noutput_items; count++){
-        switch(state){
-            case PREAMBLE_SEARCH:
-                stream->push_back(in[count]);
-                if((*stream ^ *preamble_lookup).count() <= allowed_mistakes){
-                    state = FSD_SEARCH;
-                    allowed_mistakes = d_sync_word.size();
-                    data_received = 0;
-                    delete stream;
-                    stream = new shift_reg(d_FSD_len * 8);
-                    stream->reset();
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 2 <= nbytes; i += 2){
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 8 * i));
+        unsigned m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+        out[i] = table[m & 0xff];
+        out[i + 1] = table[(m >> 8) & 0xff];
+    }
+#endif
+    for(; i < nbytes; i++){
+        uint8_t m = 0;
+        for(int j = 0; j < 8; j++){
+            m |= (in[8 * i + j] != 0) << j;
+        }
+        out[i] = table[m];
+    }
+}
+
+/*
+ * Copies nbytes bytes of packed input starting at bit pos through table,
+ * which maps a received byte, MSB first, to the output byte.
+ */
+static void
+shift_bytes(uint8_t *out, const uint8_t *in, size_t pos, size_t nbytes, const uint8_t table[256])
+{
+    const uint8_t *p = in + pos / 8;
+    int s = pos % 8;
+
+    if(s == 0){
+        for(size_t i = 0; i < nbytes; i++){
+            out[i] = table[p[i]];
+        }
+    }else{
+        for(size_t i = 0; i < nbytes; i++){
+            out[i] = table[(uint8_t)((p[i] << s) | (p[i + 1] >> (8 - s)))];
+        }
+    }
+}
+
+/*
+ * Moves the input bits of frame f, from its position up to n, into its
+ * buffer until it holds target bytes. Whole bytes are packed straight from
+ * the input and the bits of an incomplete byte wait for the next call.
+ */
+size_t
+frame_sync_impl::acquire(frame_t &f, const uint8_t *in, size_t n, size_t target)
+{
+    int t = (d_mod == PSK8) ? 0 : f.rotation;
+    size_t pos = f.pos;
+
+    /* Complete the byte the previous call started */
+    while(f.npartial > 0 && pos < n){
+        f.partial[f.npartial++] = input_bit(in, pos++);
+        if(f.npartial == 8){
+            pack_bits(&f.buffer[f.len], f.partial, 1, d_pack_table[t]);
+            f.len++;
+            f.npartial = 0;
+        }
+    }
+
+    size_t nbytes = std::min((n - pos) / 8, target - f.len);
+    if(d_stream == correlator::PACKED){
+        shift_bytes(&f.buffer[f.len], in, pos, nbytes, d_byte_table[t]);
+    }else{
+        pack_bits(&f.buffer[f.len], in + pos, nbytes, d_pack_table[t]);
+    }
+    f.len += nbytes;
+    pos += 8 * nbytes;
+
+    /* Fewer than 8 bits are left here */
+    if(f.len < target){
+        while(pos < n){
+            f.partial[f.npartial++] = input_bit(in, pos++);
+        }
+    }
+    f.pos = pos;
+    return f.len;
+}
+
+/* Turns the 8 8PSK symbols of 3 bytes back, 4 symbols per lookup */
+static inline void
+derotate_group(uint8_t *p, const uint16_t *table)
+{
+    uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+    v = (table[v >> 12] << 12) | table[v & 0xfff];
+    p[0] = v >> 16;
+    p[1] = v >> 8;
+    p[2] = v;
+}
+
+/*
+ * Turns the 8PSK symbols of the whole groups of 3 bytes acquired since the
+ * last call back by the frame rotation. With tail set, a last incomplete
+ * group is padded with zeros and turned back as well.
+ */
+void
+frame_sync_impl::derotate(frame_t &f, bool tail)
+{
+    if(d_mod != PSK8){
+        return;
+    }
+    const uint16_t *table = &d_group_table[f.rotation * 4096];
+    uint8_t *buffer = f.buffer.data();
+    for(; f.derotated + 3 <= f.len; f.derotated += 3){
+        derotate_group(buffer + f.derotated, table);
+    }
+    if(tail && f.derotated < f.len){
+        memset(buffer + f.len, 0, f.derotated + 3 - f.len);
+        derotate_group(buffer + f.derotated, table);
+        f.derotated += 3;
+    }
+}
+
+static inline float
+llr_out(float v)
+{
+    return v;
+}
+
+static inline int8_t
+llr_out(int v)
+{
+    return std::max(-127, std::min(127, v));
+}
+
+/*
+ * Turns the soft symbols of bps values each back by rotation k with the
+ * max-log rule: every sent label gets the metric of the label it was
+ * received as, and every bit the difference of the best metrics with it
+ * 0 and 1.
+ */
+template <typename T, typename A>
+static void
+derotate_llr(T *llr, size_t n, int bps, const uint8_t rot[8])
+{
+    const int M = 1 << bps;
+    A mu[8];
+
+    for(size_t i = 0; i + bps <= n; i += bps){
+        for(int l = 0; l < M; l++){
+            A m = 0;
+            for(int j = 0; j < bps; j++){
+                m += ((l >> (bps - 1 - j)) & 1) ? -(A)llr[i + j] : (A)llr[i + j];
+            }
+            mu[l] = m;
+        }
+        for(int j = 0; j < bps; j++){
+            A best[2] = {std::numeric_limits<A>::lowest(),
+                         std::numeric_limits<A>::lowest()};
+            for(int l = 0; l < M; l++){
+                int b = (l >> (bps - 1 - j)) & 1;
+                best[b] = std::max(best[b], mu[rot[l]]);
+            }
+            llr[i + j] = llr_out((best[0] - best[1]) / 2);
+        }
+    }
+}
+
+/*
+ * Copies the soft symbols of frame f, from its position up to n, until
+ * target values are held.
+ */
+size_t
+frame_sync_impl::acquire_soft(frame_t &f, const uint8_t *in, size_t n, size_t target)
+{
+    size_t k = std::min(n - f.pos, target - f.soft_len);
+
+    if(d_format == correlator::FLOAT){
+        memcpy(f.soft.data() + f.soft_len, (const float *) in + f.pos, k * sizeof(float));
+    }else{
+        memcpy(f.soft8.data() + f.soft_len, (const int8_t *) in + f.pos, k);
+    }
+    f.soft_len += k;
+    f.pos += k;
+    return f.soft_len;
+}
+
+/* Turns the whole soft symbols copied since the last call back */
+void
+frame_sync_impl::derotate_soft(frame_t &f)
+{
+    size_t n = (f.soft_len - f.soft_done) / d_bps * d_bps;
+
+    if(f.rotation != 0){
+        if(d_format == correlator::FLOAT){
+            derotate_llr<float, float>(&f.soft[f.soft_done], n, d_bps, d_rot[f.rotation]);
+        }else{
+            derotate_llr<int8_t, int>(&f.soft8[f.soft_done], n, d_bps, d_rot[f.rotation]);
+        }
+    }
+    f.soft_done += n;
+}
+
+/*
+ * Differential decoding of soft symbols with the max-log rule: the metric
+ * of every phase change is the best sum of the metrics of a previous and
+ * a current label that differ by it.
+ */
+template <typename T, typename A>
+size_t
+frame_sync_impl::differential_soft(channel_t &c, T *out, const T *in, size_t n)
+{
+    const int M = 1 << d_bps;
+    size_t total = c.diff_carry_len + n;
+    size_t nsym = total / d_bps;
+    A mu_prev[8], mu[8], metric[8];
+
+    for(int l = 0; l < M; l++){
+        A m = 0;
+        for(int j = 0; j < d_bps; j++){
+            m += ((l >> (d_bps - 1 - j)) & 1) ? -(A)c.diff_prev_llr[j] : (A)c.diff_prev_llr[j];
+        }
+        mu_prev[l] = m;
+    }
+    for(size_t s = 0; s < nsym; s++){
+        for(int j = 0; j < d_bps; j++){
+            size_t i = s * d_bps + j;
+            c.diff_prev_llr[j] = (i < c.diff_carry_len) ? c.diff_carry[i] : in[i - c.diff_carry_len];
+        }
+        for(int l = 0; l < M; l++){
+            A m = 0;
+            for(int j = 0; j < d_bps; j++){
+                m += ((l >> (d_bps - 1 - j)) & 1) ? -(A)c.diff_prev_llr[j] : (A)c.diff_prev_llr[j];
+            }
+            mu[l] = m;
+        }
+        for(int k = 0; k < M; k++){
+            A best = std::numeric_limits<A>::lowest();
+            for(int l = 0; l < M; l++){
+                best = std::max(best, mu_prev[l] + mu[d_rot[k][l]]);
+            }
+            metric[d_label[k]] = best;
+        }
+        for(int j = 0; j < d_bps; j++){
+            A best[2] = {std::numeric_limits<A>::lowest(),
+                         std::numeric_limits<A>::lowest()};
+            for(int l = 0; l < M; l++){
+                int b = (l >> (d_bps - 1 - j)) & 1;
+                best[b] = std::max(best[b], metric[l]);
+            }
+            out[s * d_bps + j] = llr_out((best[0] - best[1]) / 2);
+        }
+        std::copy(mu, mu + M, mu_prev);
+    }
+
+    float carry[2];
+    size_t k = 0;
+    for(size_t i = nsym * d_bps; i < total; i++){
+        carry[k++] = (i < c.diff_carry_len) ? c.diff_carry[i] : in[i - c.diff_carry_len];
+    }
+    std::copy(carry, carry + k, c.diff_carry);
+    c.diff_carry_len = k;
+    return nsym * d_bps;
+}
+
+/*
+ * Decodes the differential mapping of n input values of channel ch into
+ * its diff buffer and returns the values decoded. Soft values stay in
+ * their format and hard bits come out packed. The values of a symbol split between two calls
+ * wait for the next one.
+ */
+size_t
+frame_sync_impl::differential(channel_t &ch, const uint8_t *in, size_t n)
+{
+    const int M = 1 << d_bps;
+    const uint8_t *p = in;
+    size_t c = ch.diff_carry_len;
+    size_t total = c + n;
+
+    switch(d_format){
+        case correlator::FLOAT:
+            ch.diff.resize((n + 2) * sizeof(float));
+            return differential_soft<float, float>(ch, (float *) ch.diff.data(),
+                                                   (const float *) in, n);
+        case correlator::INT8:
+            ch.diff.resize(n + 2);
+            return differential_soft<int8_t, int>(ch, (int8_t *) ch.diff.data(),
+                                                  (const int8_t *) in, n);
+        case correlator::UNPACKED: {
+            /* Packed after the bits of the incomplete symbol */
+            ch.diff_in.assign(total / 8 + 2, 0);
+            size_t head = std::min(n, 8 - c);
+            for(size_t i = 0; i < total; i++){
+                if(i == head + c && i % 8 == 0){
+                    size_t nbytes = (total - i) / 8;
+                    pack_bits(&ch.diff_in[i / 8], in + head, nbytes, d_pack_table[0]);
+                    i += 8 * nbytes;
+                    if(i == total){
+                        break;
+                    }
                 }
-                break;
-            case FSD_SEARCH:
-                stream->push_back(in[count]);
-                data_received++;
-                if((*stream ^ *FSD_lookup).count() <= allowed_mistakes){
-                    state = SIZE_AQUISITION;
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    BPSK_inversed = false;
-                    rotation = R_0;
-                    delete stream;
-                    stream = nullptr;
-                }else if ((d_mod == BPSK) && ((*stream ^ *FSD_lookup).count() >= (FSD_lookup->size() - allowed_mistakes))){
-                    state = SIZE_AQUISITION;
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    BPSK_inversed = true;
-                    delete stream;
-                    stream = nullptr;
-                }else if ((d_mod == QPSK) && ((*stream ^ *FSD_lookup_90).count() <= allowed_mistakes)){
-                    state = SIZE_AQUISITION;
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    rotation = R_90;
-                    delete stream;
-                    stream = nullptr;
-                }else if ((d_mod == QPSK) && ((*stream ^ *FSD_lookup_180).count() <= allowed_mistakes)){
-                    state = SIZE_AQUISITION;
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    rotation = R_180;
-                    delete stream;
-                    stream = nullptr;
-                }else if ((d_mod == QPSK) && ((*stream ^ *FSD_lookup_270).count() <= allowed_mistakes)){
-                    state = SIZE_AQUISITION;
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    rotation = R_270;
-                    delete stream;
-                    stream = nullptr;
-                }else if (data_received > ((d_preamble_len + d_sync_word.size()) * 8)){
-                    state = PREAMBLE_SEARCH;
-                    allowed_mistakes = (d_preamble_len * 4) / 10;
-                    delete stream;
-                    stream = new shift_reg(d_preamble_len * 4);
-                    stream->reset();
+                uint8_t b = (i < c) ? (uint8_t) ch.diff_carry[i] : (in[i - c] != 0);
+                ch.diff_in[i / 8] |= b << (7 - i % 8);
+            }
+            p = ch.diff_in.data();
+            break;
+        }
+        default:
+            if(c){
+                /* Shifted right behind the bits of the incomplete symbol */
+                ch.diff_in.assign(total / 8 + 2, 0);
+                for(size_t i = 0; i < c; i++){
+                    ch.diff_in[0] |= (uint8_t) ch.diff_carry[i] << (7 - i);
                 }
-                break;
-            case SIZE_AQUISITION:
-                if(d_mod == BPSK)
-                    byteBuffer[7 - byteBufferIntex] = BPSK_inversed ? (!in[count]) : in[count];
-                else if(d_mod == QPSK){
-                    if(has_save_bit){
-                        switch(rotation){
-                            case R_0:
-                                byteBuffer[6 - byteBufferIntex] = saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = in[count];
-                                break;
-                            case R_90: 
-                                byteBuffer[6 - byteBufferIntex] = !saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = saved_bit ^ in[count];
-                                break;
-                            case R_180:
-                                byteBuffer[6 - byteBufferIntex] = saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = !in[count]; 
-                                break;
-                            case R_270: 
-                                byteBuffer[6 - byteBufferIntex] = !saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = !(saved_bit ^ in[count]);
-                                break;
-                        }
-                        has_save_bit = false;
-                    }else{
-                        saved_bit = in[count];
-                        has_save_bit = true;
-                    }
+                for(size_t k = 0; k < n / 8; k++){
+                    ch.diff_in[k] |= in[k] >> c;
+                    ch.diff_in[k + 1] = in[k] << (8 - c);
                 }
-                byteBufferIntex++;
-                if(byteBufferIntex == 8){
-                    buffer[bufferIntex] = ((byteBuffer[7] << 7) | (byteBuffer[6] << 6) | (byteBuffer[5] << 5) | (byteBuffer[4] << 4) | (byteBuffer[3] << 3) | (byteBuffer[2] << 2) | (byteBuffer[1] << 1) | (byteBuffer[0]));
-                    bufferIntex++;
-                    byteBufferIntex = 0;
+                p = ch.diff_in.data();
+            }
+            break;
+    }
+
+    size_t nsym = total / d_bps;
+    size_t s = 0;
+    ch.diff.assign(total / 8 + 2, 0);
+    if(d_bps < 3){
+        /* Symbols never cross bytes, 4 or 8 of them per lookup */
+        for(size_t i = 0; i < total / 8; i++){
+            ch.diff[i] = d_diff_bytes[ch.diff_prev][p[i]];
+            ch.diff_prev = p[i] & (M - 1);
+        }
+        s = (total / 8) * 8 / d_bps;
+    }
+    for(; s < nsym; s++){
+        uint8_t l = 0;
+        for(int j = 0; j < d_bps; j++){
+            size_t i = s * d_bps + j;
+            l = (l << 1) | ((p[i / 8] >> (7 - i % 8)) & 1);
+        }
+        uint8_t d = d_diff_table[ch.diff_prev][l];
+        ch.diff_prev = l;
+        for(int j = 0; j < d_bps; j++){
+            size_t i = s * d_bps + j;
+            ch.diff[i / 8] |= ((d >> (d_bps - 1 - j)) & 1) << (7 - i % 8);
+        }
+    }
+
+    ch.diff_carry_len = 0;
+    for(size_t i = nsym * d_bps; i < total; i++){
+        ch.diff_carry[ch.diff_carry_len++] = (p[i / 8] >> (7 - i % 8)) & 1;
+    }
+    return nsym * d_bps;
+}
+
+/* Goes back to looking for a preamble */
+void
+frame_sync_impl::rearm(channel_t &c)
+{
+    c.state = PREAMBLE_SEARCH;
+    c.allowed_mistakes = c.preamble_threshold;
+    c.preamble_corr.reset();
+}
+
+/*
+ * Adds the mismatches of a sync word found to the bit error rate, which
+ * averages over the last 16 or so, and sets the thresholds to what a
+ * window at that rate stays within but for 1 in 10^4 times. A floor of
+ * 10^-3 keeps them from closing on a clean channel.
+ */
+void
+frame_sync_impl::update_thresholds(channel_t &c, size_t errors)
+{
+    c.errors = c.errors * 15 / 16 + errors;
+    c.error_bits = c.error_bits * 15 / 16 + d_FSD_corr.len();
+    if(d_false_alarm_rate <= 0){
+        return;
+    }
+    double ber = std::max(c.errors / c.error_bits, 1e-3);
+    c.preamble_threshold = std::min(d_preamble_max,
+                                    miss_threshold(d_preamble_corr.len(), ber, 1e-4));
+    c.FSD_threshold = std::min(d_FSD_max,
+                               miss_threshold(d_FSD_corr.len(), ber, 1e-4));
+}
+
+size_t
+frame_sync_impl::search(channel_t &c, correlator &corr, const uint8_t *in, size_t pos, size_t n,
+                        int &match)
+{
+    switch(d_stream){
+        case correlator::PACKED:
+            return corr.search_packed(in, pos, n, c.allowed_mistakes, match);
+        case correlator::FLOAT:
+            return corr.search_soft((const float *) in + pos, n, c.allowed_mistakes, match);
+        case correlator::INT8:
+            return corr.search_soft((const int8_t *) in + pos, n, c.allowed_mistakes, match);
+        default:
+            return corr.search(in + pos, n, c.allowed_mistakes, match);
+    }
+}
+
+/*
+ * Starts receiving a frame at position pos of the input, where its sync
+ * word ended. There is always a free frame when the search runs.
+ */
+void
+frame_sync_impl::start(channel_t &c, size_t pos, uint8_t rotation, size_t vcid)
+{
+    size_t i = 0;
+    while(std::find(c.busy.begin(), c.busy.end(), i) != c.busy.end()){
+        i++;
+    }
+    frame_t &f = c.frames[i];
+    f.state = SIZE_AQUISITION;
+    f.rotation = rotation;
+    f.vcid = vcid;
+    f.size = 0;
+    f.pos = pos;
+    f.npartial = 0;
+    f.len = 0;
+    f.derotated = 0;
+    f.soft_len = 0;
+    f.soft_done = 0;
+    f.id = c.frame_id++;
+    f.sync_pos = c.offset + pos;
+    f.sent = 0;
+    c.busy.push_back(i);
+}
+
+/*
+ * Receives frame f from its position up to total and returns true once it
+ * is over, with its position where it ended. A frame is published when
+ * its header checks and all of it has been received.
+ */
+bool
+frame_sync_impl::receive(channel_t &c, frame_t &f, const uint8_t *in, size_t total)
+{
+    const bool soft = (d_format == correlator::FLOAT || d_format == correlator::INT8);
+
+    if(f.state == SIZE_AQUISITION){
+        /*
+         * The header with the payload length comes first, after the bits
+         * of the sync word that make no whole symbol
+         */
+        size_t hbytes = frame_header::size(d_header);
+        size_t off = d_head_bits - 8 * hbytes;
+        uint8_t hdr[6] = {0, 0, 0, 0, 0, 0};
+        if(soft){
+            if(acquire_soft(f, in, total, frame_values(d_head_bits)) < frame_values(d_head_bits)){
+                return false;
+            }
+            derotate_soft(f);
+            for(size_t i = 0; i < 8 * hbytes; i++){
+                bool one = (d_format == correlator::FLOAT) ? f.soft[off + i] < 0 :
+                           f.soft8[off + i] < 0;
+                hdr[i / 8] |= one << (7 - i % 8);
+            }
+        }else{
+            if(acquire(f, in, total, frame_bytes(d_head_bits)) < frame_bytes(d_head_bits)){
+                return false;
+            }
+            /*
+             * The header ends within the first 3 groups of 3 bytes, the
+             * last of which may still miss bits of the payload
+             */
+            uint8_t head[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+            memcpy(head, f.buffer.data(), std::min(f.len, (size_t) 9));
+            if(d_mod == PSK8){
+                for(int i = 0; i < 9; i += 3){
+                    derotate_group(head + i, &d_group_table[f.rotation * 4096]);
                 }
-                if(bufferIntex == 2){
-                    state = DATA_AQUISITION;
-                    messageSize = (buffer[0] << 8) | buffer[1];
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    if(messageSize > max_size){
-                        state = PREAMBLE_SEARCH;
-                        allowed_mistakes = (d_preamble_len * 4) / 10;
-                        delete stream;
-                        stream = new shift_reg(d_preamble_len * 4);
-                        stream->reset();
-                    }
+            }
+            shift_bytes(hdr, head, off, hbytes, d_byte_table[0]);
+        }
+        /* A header that does not check ends the frame right away */
+        if(!frame_header::decode(hdr, d_header, d_golay, f.size)
+           || f.size > max_size){
+            c.false_locks++;
+            return true;
+        }
+        f.state = DATA_AQUISITION;
+    }
+
+    size_t bits = d_head_bits + 8 * (size_t)f.size;
+    bool done;
+    if(soft){
+        done = acquire_soft(f, in, total, frame_values(bits)) == frame_values(bits);
+    }else{
+        done = acquire(f, in, total, frame_bytes(bits)) == frame_bytes(bits);
+    }
+    if(d_chunk_size){
+        cut_through(c, f, done);
+        return done;
+    }
+    if(!done){
+        return false;
+    }
+
+    pmt::pmt_t pdu;
+    if(soft){
+        /* Soft input gives an LLR PDU of 8 values per byte */
+        derotate_soft(f);
+        if(d_format == correlator::FLOAT){
+            pdu = pmt::init_f32vector(8 * f.size, &f.soft[d_head_bits]);
+        }else{
+            pdu = pmt::init_s8vector(8 * f.size, &f.soft8[d_head_bits]);
+        }
+    }else{
+        derotate(f, true);
+        uint8_t *buffer = f.buffer.data();
+        const uint8_t *payload = buffer + d_head_bits / 8;
+        if(d_head_bits % 8){
+            /* Moved to the start of buffer, back on a byte boundary */
+            shift_bytes(buffer, buffer, d_head_bits, f.size, d_byte_table[0]);
+            payload = buffer;
+        }
+        pdu = pmt::make_blob(payload, f.size);
+    }
+    c.pdus.push_back(pmt::cons(frame_meta(c, f), pdu));
+    return true;
+}
+
+/* Metadata of a PDU with the payload of frame f */
+pmt::pmt_t
+frame_sync_impl::frame_meta(const channel_t &c, const frame_t &f) const
+{
+    pmt::pmt_t meta = pmt::make_dict();
+    meta = add_stat(meta, "preamble_threshold", c.preamble_threshold);
+    meta = add_stat(meta, "sync_word_threshold", c.FSD_threshold);
+    meta = add_stat(meta, "sync_locks", c.locks);
+    meta = add_stat(meta, "sync_false_locks", c.false_locks);
+    meta = add_stat(meta, "vcid", f.vcid);
+    meta = add_stat(meta, "channel", &c - d_channels.data());
+    meta = add_stat(meta, "stream_offset", f.sync_pos);
+    return meta;
+}
+
+/*
+ * Cut-through delivery: publishes the payload of frame f, as far as it
+ * has been received and turned back, in chunks of d_chunk_size bytes. The
+ * last chunk, which may be shorter, waits for the whole frame and has the
+ * final flag set.
+ */
+void
+frame_sync_impl::cut_through(channel_t &c, frame_t &f, bool done)
+{
+    const bool soft = (d_format == correlator::FLOAT || d_format == correlator::INT8);
+    size_t ready;
+
+    if(soft){
+        derotate_soft(f);
+        ready = f.soft_done > d_head_bits ? (f.soft_done - d_head_bits) / 8 : 0;
+    }else{
+        derotate(f, done);
+        size_t n = (d_mod == PSK8) ? f.derotated : f.len;
+        ready = 8 * n > d_head_bits ? (8 * n - d_head_bits) / 8 : 0;
+    }
+    ready = std::min(ready, (size_t) f.size);
+
+    for(;;){
+        size_t n = std::min(d_chunk_size, ready - f.sent);
+        bool last = (f.sent + n == f.size);
+        if(last ? !done : n < d_chunk_size){
+            return;
+        }
+        pmt::pmt_t chunk;
+        if(d_format == correlator::FLOAT){
+            chunk = pmt::init_f32vector(8 * n, f.soft.data() + d_head_bits + 8 * f.sent);
+        }else if(d_format == correlator::INT8){
+            chunk = pmt::init_s8vector(8 * n, f.soft8.data() + d_head_bits + 8 * f.sent);
+        }else{
+            uint8_t *p = f.buffer.data() + d_head_bits / 8 + f.sent;
+            if(d_head_bits % 8){
+                /*
+                 * Moved back on a byte boundary in place, which leaves the
+                 * first byte of the next chunk as it was
+                 */
+                shift_bytes(p, f.buffer.data(), d_head_bits + 8 * f.sent, n,
+                            d_byte_table[0]);
+            }
+            chunk = pmt::make_blob(p, n);
+        }
+        pmt::pmt_t meta = frame_meta(c, f);
+        meta = add_stat(meta, "frame_id", f.id);
+        meta = add_stat(meta, "frame_size", f.size);
+        meta = add_stat(meta, "offset", f.sent);
+        meta = pmt::dict_add(meta, pmt::mp("final"), pmt::from_bool(last));
+        c.pdus.push_back(pmt::cons(meta, chunk));
+        f.sent += n;
+        if(last){
+            return;
+        }
+    }
+}
+
+/*
+ * Receives all the busy frames up to total, in the order their sync words
+ * came in, and returns the earliest position where one ended, or total.
+ */
+size_t
+frame_sync_impl::receive(channel_t &c, const uint8_t *in, size_t total)
+{
+    size_t end = total;
+
+    for(size_t i = 0; i < c.busy.size();){
+        frame_t &f = c.frames[c.busy[i]];
+        if(receive(c, f, in, total)){
+            end = std::min(end, f.pos);
+            c.busy.erase(c.busy.begin() + i);
+        }else{
+            i++;
+        }
+    }
+    return end;
+}
+
+/*
+ * Searches the noutput_items input items of a channel and receives its
+ * frames. Channels share no state they write to, so this runs on any
+ * thread.
+ */
+void
+frame_sync_impl::process(size_t channel, const uint8_t *in, int noutput_items)
+{
+    channel_t &c = d_channels[channel];
+    int match;
+
+    /* Positions count bits, 8 per input item in packed mode */
+    size_t total = (d_format == correlator::PACKED) ? 8 * (size_t)noutput_items : noutput_items;
+    if(d_differential){
+        total = differential(c, in, total);
+        in = c.diff.data();
+    }
+    size_t count = 0;
+    while(count < total){
+        if(c.busy.size() == c.frames.size()){
+            /*
+             * With every frame busy the search waits for one to end, and
+             * starts over there
+             */
+            size_t end = receive(c, in, total);
+            if(end > count){
+                count = end;
+                rearm(c);
+            }
+            continue;
+        }
+        switch(c.state){
+            case PREAMBLE_SEARCH:
+                /* Scan ahead for the preamble, all the remaining bits at once */
+                count += search(c, c.preamble_corr, in, count, total - count, match);
+                if(match >= 0){
+                    c.state = FSD_SEARCH;
+                    c.allowed_mistakes = c.FSD_threshold;
+                    c.data_received = 0;
+                    c.FSD_corr.reset();
                 }
                 break;
-            case DATA_AQUISITION:
-                if(d_mod == BPSK)
-                    byteBuffer[7 - byteBufferIntex] = BPSK_inversed ? (!in[count]) : in[count];
-                else if(d_mod == QPSK){
-                    if(has_save_bit){
-                        switch(rotation){
-                            case R_0:
-                                byteBuffer[6 - byteBufferIntex] = saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = in[count];
-                                break;
-                            case R_90: 
-                                byteBuffer[6 - byteBufferIntex] = !saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = saved_bit ^ in[count];
-                                break;
-                            case R_180:
-                                byteBuffer[6 - byteBufferIntex] = saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = !in[count]; 
-                                break;
-                            case R_270: 
-                                byteBuffer[6 - byteBufferIntex] = !saved_bit;
-                                byteBuffer[7 - byteBufferIntex] = !(saved_bit ^ in[count]);
-                                break;
-                        }
-                        has_save_bit = false;
-                    }else{
-                        saved_bit = in[count];
-                        has_save_bit = true;
-                    }
-                }
-                byteBufferIntex++;
-                if(byteBufferIntex == 8){
-                    buffer[bufferIntex] = ((byteBuffer[7] << 7) | (byteBuffer[6] << 6) | (byteBuffer[5] << 5) | (byteBuffer[4] << 4) | (byteBuffer[3] << 3) | (byteBuffer[2] << 2) | (byteBuffer[1] << 1) | (byteBuffer[0]));
-                    bufferIntex++;
-                    byteBufferIntex = 0;
+            case FSD_SEARCH: {
+                /*
+                 * Stop at the bit where the sync word is given up. Being a
+                 * uint8_t, data_received never gets past a limit of 255.
+                 */
+                size_t limit = (d_preamble_len + d_FSD_len) * 8;
+                size_t n = total - count;
+                if(limit < 255){
+                    n = std::min(n, limit + 1 - c.data_received);
                 }
-                if(bufferIntex == messageSize){
-                    message_port_pub(pmt::mp("pdu"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, messageSize)));
-                    state = PREAMBLE_SEARCH;
-                    allowed_mistakes = (d_preamble_len * 4) / 10;
-                    delete stream;
-                    stream = new shift_reg(d_preamble_len * 4);
-                    stream->reset();
-                    byteBufferIntex = 0;
-                    bufferIntex = 0;
-                    messageSize = 0;
+                size_t used = search(c, c.FSD_corr, in, count, n, match);
+                count += used;
+                c.data_received += used;
+                if(match >= 0){
+                    /*
+                     * The patterns follow the rotations. The frame is
+                     * received on its own and the search goes on after the
+                     * sync word.
+                     */
+                    c.locks++;
+                    update_thresholds(c, c.FSD_corr.distance(match));
+                    start(c, count, match % d_nrot, match / d_nrot);
+                    rearm(c);
+                }else if (c.data_received > limit){
+                    rearm(c);
                 }
                 break;
+            }
+            default:
+                rearm(c);
+                break;
+        }
+    }
+    receive(c, in, total);
+    /* Positions start over with the next call */
+    for(size_t i : c.busy){
+        c.frames[i].pos = 0;
+    }
+    c.offset += total;
+}
+
+void
+frame_sync_impl::run(const void *in, int nitems, std::vector<pmt::pmt_t> &pdus)
+{
+    process(0, (const uint8_t *) in, nitems);
+    pdus.insert(pdus.end(), d_channels[0].pdus.begin(), d_channels[0].pdus.end());
+    d_channels[0].pdus.clear();
+}
+
+/* Processes the channels of the current call until none is left */
+void
+frame_sync_impl::run_batch()
+{
+    for(;;){
+        size_t i = d_next++;
+        if(i >= d_channels.size()){
+            return;
+        }
+        process(i, (const uint8_t *) (*d_batch_in)[i], d_batch_items);
+    }
+}
+
+/* Takes part in every batch after the given one */
+void
+frame_sync_impl::worker(uint64_t batch)
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+
+    for(;;){
+        d_batch_cv.wait(lock, [&] { return d_stop || d_batch != batch; });
+        if(d_stop){
+            return;
+        }
+        batch = d_batch;
+        lock.unlock();
+        run_batch();
+        lock.lock();
+        if(--d_pending == 0){
+            d_done_cv.notify_one();
+        }
+    }
+}
+
+/*
+ * The workers run from start to stop. Together with the scheduler thread
+ * they are as many as the cores, or nthreads, but no more than the
+ * channels.
+ */
+bool
+frame_sync_impl::start()
+{
+    size_t n = d_nthreads > 0 ? d_nthreads : std::thread::hardware_concurrency();
+    n = std::min(std::max(n, (size_t) 1), d_channels.size());
+
+    d_stop = false;
+    for(size_t i = 1; i < n; i++){
+        d_workers.emplace_back(&frame_sync_impl::worker, this, d_batch);
+    }
+    return sync_block::start();
+}
+
+bool
+frame_sync_impl::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stop = true;
+    }
+    d_batch_cv.notify_all();
+    for(std::thread &t : d_workers){
+        t.join();
+    }
+    d_workers.clear();
+    return sync_block::stop();
+}
+
+int
+frame_sync_impl::work(int noutput_items,
+                      gr_vector_const_void_star &input_items,
+                      gr_vector_void_star &output_items)
+{
+    if(d_workers.empty()){
+        for(size_t i = 0; i < d_channels.size(); i++){
+            process(i, (const uint8_t *) input_items[i], noutput_items);
+        }
+    }else{
+        /* The channels of this call make a batch for all the threads */
+        {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            d_batch_in = &input_items;
+            d_batch_items = noutput_items;
+            d_next = 0;
+            d_pending = d_workers.size();
+            d_batch++;
+        }
+        d_batch_cv.notify_all();
+        run_batch();
+        std::unique_lock<std::mutex> lock(d_mutex);
+        d_done_cv.wait(lock, [this] { return d_pending == 0; });
+    }
+
+    /* Published from here only, in channel order */
+    for(channel_t &c : d_channels){
+        for(const pmt::pmt_t &pdu : c.pdus){
+            message_port_pub(pmt::mp("pdu"), pdu);
         }
+        c.pdus.clear();
     }
 
     // Tell runtime system how many output items we produced.
@@ -22,7 +22,13 @@
 #define INCLUDED_TUTORIAL_FRAME_SYNC_IMPL_H
 
 #include <tutorial/frame_sync.h>
-#include <tutorial/shift_reg.h>
+#include "correlator.h"
+#include "psk.h"
+#include "frame_header.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace gr {
 namespace tutorial {
@@ -31,7 +37,8 @@ class frame_sync_impl : public frame_sync {
 private:
     typedef enum {
         BPSK,
-        QPSK
+        QPSK,
+        PSK8
     } mod_t;
 
     typedef enum {
@@ -41,44 +48,290 @@ private:
         DATA_AQUISITION
     } state_t;
 
-    typedef enum {
-        R_0,
-        R_90,
-        R_180,
-        R_270
-    } rotation_t;
-
     const mod_t d_mod;
-    shift_reg* stream;
-    shift_reg* preamble_lookup;
-    shift_reg* FSD_lookup;
-    shift_reg* FSD_lookup_90;
-    shift_reg* FSD_lookup_180;
-    shift_reg* FSD_lookup_270;
-    uint8_t allowed_mistakes;
-    state_t state;
+    /* Bits per symbol */
+    const int d_bps;
+    /*
+     * One bit per byte, packed bytes MSB first, or float or int8 soft
+     * symbols with a negative one meaning 1
+     */
+    const correlator::format_t d_format;
+    /*
+     * Differential mapping: every symbol carries the phase change from the
+     * one before it, so the input is decoded first and has no rotation
+     */
+    const bool d_differential;
+    /*
+     * Format of the stream searched: the input format, or packed after
+     * hard differential decoding
+     */
+    const correlator::format_t d_stream;
+    /*
+     * The preamble and sync word patterns. Every channel searches with a
+     * copy of its own.
+     */
+    correlator d_preamble_corr;
+    /*
+     * Sync words, one per virtual channel. They all have the same length
+     * and are searched for at once.
+     */
+    const size_t d_nsync_words;
+    /*
+     * Sync word patterns, the whole symbols of them: as sent, then
+     * rotated by 1 .. M - 1 steps of 360 / M degrees
+     */
+    correlator d_FSD_corr;
+    /* Rotations searched for, per sync word */
+    const int d_nrot;
+    /*
+     * Largest correlation thresholds. With a false alarm rate set, they
+     * keep random bits under that rate, and the thresholds of a channel
+     * follow the bit error rate measured on the sync words it found.
+     */
+    const double d_false_alarm_rate;
+    size_t d_preamble_max;
+    size_t d_FSD_max;
+    /* Header format, see frame_header.h */
+    const int d_header;
+    golay24 d_golay;
+    /*
+     * Payload bytes per PDU in cut-through mode, which publishes a frame
+     * while it is being received. Zero waits for the whole frame.
+     */
+    const size_t d_chunk_size;
+    /*
+     * A frame being received from the sync word on. Frames are received
+     * while the search for the next preamble goes on, so a false lock does
+     * not hide the frame right behind it.
+     */
+    struct frame_t {
+        state_t state;
+        /* Rotation of the frame, in steps of 360 / M degrees */
+        uint8_t rotation;
+        /* Virtual channel, the index of the sync word found */
+        size_t vcid;
+        /* Number of the frame in its channel */
+        uint64_t id;
+        /* Position in the stream where its sync word ended */
+        uint64_t sync_pos;
+        uint16_t size;
+        /* Payload bytes published so far in cut-through mode */
+        size_t sent;
+        /* Position reached in the input of the current call */
+        size_t pos;
+        /* The bits of an incomplete byte */
+        uint8_t partial[8];
+        size_t npartial;
+        std::vector<uint8_t> buffer;
+        size_t len;
+        /* Bytes of buffer already turned back by the frame rotation */
+        size_t derotated;
+        /* Soft symbols received, for soft input */
+        std::vector<float> soft;
+        std::vector<int8_t> soft8;
+        size_t soft_len;
+        size_t soft_done;
+    };
+
+    /*
+     * Everything about one input stream. Channels share nothing they
+     * write to, so they are processed side by side.
+     */
+    struct channel_t {
+        /* State of the search, PREAMBLE_SEARCH or FSD_SEARCH */
+        state_t state;
+        correlator preamble_corr;
+        correlator FSD_corr;
+        size_t allowed_mistakes;
+        uint8_t data_received;
+        size_t preamble_threshold;
+        size_t FSD_threshold;
+        /* Sync word mismatches and bits, decaying averages */
+        double errors;
+        double error_bits;
+        /* Sync words found, and those that turned out to be no frame */
+        uint64_t locks;
+        uint64_t false_locks;
+        /* Number of the next frame */
+        uint64_t frame_id;
+        /* Positions of the input before the current call */
+        uint64_t offset;
+        /*
+         * The fixed pool of frames, and the busy ones in the order their
+         * sync words came in
+         */
+        std::vector<frame_t> frames;
+        std::vector<size_t> busy;
+        /* Differentially decoded input, and hard input packed for it */
+        std::vector<uint8_t> diff;
+        std::vector<uint8_t> diff_in;
+        /* The previous symbol, and the values of an incomplete one */
+        uint8_t diff_prev;
+        float diff_prev_llr[3];
+        float diff_carry[2];
+        size_t diff_carry_len;
+        /* PDUs of the current call, published in channel order */
+        std::vector<pmt::pmt_t> pdus;
+
+        channel_t(const correlator &preamble, const correlator &FSD)
+            : preamble_corr(preamble),
+              FSD_corr(FSD)
+        {
+        }
+    };
+
     const uint8_t d_preamble_len;
     uint8_t d_FSD_len;
     const uint8_t d_preamble;
     const std::vector<uint8_t> d_sync_word;
-    uint8_t data_received;
-    uint8_t *byteBuffer;
-    uint8_t byteBufferIntex;
-    uint8_t *buffer;
-    size_t bufferIntex;
-    uint16_t messageSize;
-    bool BPSK_inversed;
-    rotation_t rotation;
-    uint8_t saved_bit;
-    bool has_save_bit;
     size_t max_size;
+    /*
+     * Bits from the end of the sync word pattern, which is on a symbol
+     * boundary, to the payload: the rest of the sync word and the header
+     */
+    size_t d_head_bits;
+    std::vector<channel_t> d_channels;
+    /*
+     * Symbol labels, for every rotation k, received for a sent label and
+     * sent for a received label
+     */
+    uint8_t d_rot[8][8];
+    uint8_t d_derot[8][8];
+    /* Label of the point at every phase */
+    uint8_t d_label[8];
+    /*
+     * Packing of 8 received bits, turned back by each rotation for BPSK
+     * and QPSK, and just packed for 8PSK
+     */
+    uint8_t d_pack_table[4][256];
+    /* The same for a packed received byte */
+    uint8_t d_byte_table[4][256];
+    /* 8PSK rotations of 4 symbols, 12 bits, turned back at once */
+    std::vector<uint16_t> d_group_table;
+
+    /* Label of the phase change between two received labels */
+    uint8_t d_diff_table[8][8];
+    /* The same for the BPSK or QPSK symbols of a packed byte */
+    uint8_t d_diff_bytes[4][256];
+
+    /*
+     * Worker threads, which with the scheduler thread take the channels
+     * of a call one at a time
+     */
+    const int d_nthreads;
+    std::vector<std::thread> d_workers;
+    std::mutex d_mutex;
+    std::condition_variable d_batch_cv;
+    std::condition_variable d_done_cv;
+    uint64_t d_batch;
+    bool d_stop;
+    std::atomic<size_t> d_next;
+    size_t d_pending;
+    const gr_vector_const_void_star *d_batch_in;
+    int d_batch_items;
+
+    uint8_t
+    input_bit(const uint8_t *in, size_t pos) const
+    {
+        switch(d_stream){
+            case correlator::PACKED:
+                return (in[pos / 8] >> (7 - pos % 8)) & 1;
+            default:
+                return in[pos];
+        }
+    }
+
+    /* Values of the whole symbols holding bits bits */
+    size_t
+    frame_values(size_t bits) const
+    {
+        return (bits + d_bps - 1) / d_bps * d_bps;
+    }
+
+    /* Bytes holding the whole symbols with bits bits */
+    size_t
+    frame_bytes(size_t bits) const
+    {
+        return (frame_values(bits) + 7) / 8;
+    }
+
+    void rearm(channel_t &c);
+    void update_thresholds(channel_t &c, size_t errors);
+    size_t search(channel_t &c, correlator &corr, const uint8_t *in,
+                  size_t pos, size_t n, int &match);
+    size_t acquire(frame_t &f, const uint8_t *in, size_t n, size_t target);
+    void derotate(frame_t &f, bool tail);
+    size_t acquire_soft(frame_t &f, const uint8_t *in, size_t n, size_t target);
+    void derotate_soft(frame_t &f);
+    void start(channel_t &c, size_t pos, uint8_t rotation, size_t vcid);
+    bool receive(channel_t &c, frame_t &f, const uint8_t *in, size_t total);
+    size_t receive(channel_t &c, const uint8_t *in, size_t total);
+    pmt::pmt_t frame_meta(const channel_t &c, const frame_t &f) const;
+    void cut_through(channel_t &c, frame_t &f, bool done);
+    size_t differential(channel_t &c, const uint8_t *in, size_t n);
+    template <typename T, typename A>
+    size_t differential_soft(channel_t &c, T *out, const T *in, size_t n);
+    void process(size_t channel, const uint8_t *in, int noutput_items);
+    void run_batch();
+    void worker(uint64_t batch);
 
 public:
     frame_sync_impl(uint8_t preamble, uint8_t preamble_len,
                     const std::vector<uint8_t> &sync_word,
-                    int mod);
+                    int mod, int input_format, bool differential,
+                    double false_alarm_rate, int header_format,
+                    int max_contexts, size_t nsync_words,
+                    int nchannels, int nthreads, size_t chunk_size);
     ~frame_sync_impl();
 
+    bool start();
+    bool stop();
+
+    size_t
+    preamble_threshold(size_t channel = 0) const
+    {
+        return d_channels[channel].preamble_threshold;
+    }
+
+    size_t
+    sync_word_threshold(size_t channel = 0) const
+    {
+        return d_channels[channel].FSD_threshold;
+    }
+
+    /* Bit error rate measured on the sync words found */
+    double
+    bit_error_rate(size_t channel = 0) const
+    {
+        const channel_t &c = d_channels[channel];
+        return c.error_bits > 0 ? c.errors / c.error_bits : 0.0;
+    }
+
+    /* Share of the sync words found that turned out to be no frame */
+    double
+    false_lock_rate(size_t channel = 0) const
+    {
+        const channel_t &c = d_channels[channel];
+        return c.locks ? (double) c.false_locks / c.locks : 0.0;
+    }
+
+    /*
+     * Positions from the start of a preamble to the end of the longest
+     * frame
+     */
+    size_t
+    max_frame_len() const
+    {
+        return 8 * (d_preamble_len + d_FSD_len + frame_header::size(d_header)
+                    + max_size) + 2 * d_bps;
+    }
+
+    /*
+     * Searches nitems items of a single channel and hands back the PDUs
+     * found instead of publishing them, for use outside a flowgraph
+     */
+    void run(const void *in, int nitems, std::vector<pmt::pmt_t> &pdus);
+
     // Where all the action really happens
     int work(
         int noutput_items,
@@ -24,26 +24,44 @@
 
 #include <gnuradio/io_signature.h>
 #include "framer_impl.h"
+#include <algorithm>
+#include <stdexcept>
 
 namespace gr {
 namespace tutorial {
 
 framer::sptr
 framer::make(uint8_t preamble, size_t preamble_len,
-             const std::vector<uint8_t> &sync_word)
+             const std::vector<uint8_t> &sync_word, int mod,
+             bool differential, int header_format, size_t nsync_words)
 {
     return gnuradio::get_initial_sptr(
-               new framer_impl(preamble, preamble_len, sync_word));
+               new framer_impl(preamble, preamble_len, sync_word, mod,
+                               differential, header_format, nsync_words));
 }
 
 /*
  * The private constructor
  */
 framer_impl::framer_impl(uint8_t preamble, size_t preamble_len,
-                         const std::vector<uint8_t> &sync_word) :
+                         const std::vector<uint8_t> &sync_word, int mod,
+                         bool differential, int header_format,
+                         size_t nsync_words) :
     gr::block("framer", gr::io_signature::make(0, 0, 0),
-              gr::io_signature::make(0, 0, 0))
+              gr::io_signature::make(0, 0, 0)),
+    d_preamble(preamble),
+    d_preamble_len(preamble_len),
+    d_sync_word(sync_word),
+    d_nsync_words(std::max(nsync_words, (size_t) 1)),
+    d_mod(mod),
+    d_differential(differential),
+    d_header(header_format)
 {
+    if(sync_word.size() % d_nsync_words){
+        throw std::invalid_argument("framer: Invalid sync words");
+    }
+    d_sync_len = sync_word.size() / d_nsync_words;
+
     message_port_register_in(pmt::mp("pdu"));
     message_port_register_out(pmt::mp("frame"));
 
@@ -58,15 +76,47 @@ framer_impl::framer_impl(uint8_t preamble, size_t preamble_len,
 
     max_size = 3 * 2048;
 
-    buffer = new uint8_t[max_size + 2 + sync_word.size() + preamble_len];
+    buffer = new uint8_t[max_size + frame_header::size(d_header) + d_sync_len + preamble_len];
 
+    /* The sync word goes after the preamble, for the channel of every PDU */
     std::fill_n(buffer, preamble_len, preamble);
 
-    for (int i = 0; i < sync_word.size(); i++){
-        buffer[preamble_len + i] = sync_word[i];
-    }
+    bufferStart = preamble_len + d_sync_len;
+
+    /* Up to 2 bytes of padding to whole 8PSK symbols */
+    d_encoded = new uint8_t[max_size + frame_header::size(d_header) + d_sync_len + preamble_len + 2];
+    d_phase = 0;
+}
 
-    bufferStart = preamble_len + sync_word.size();
+/*
+ * Maps the len bytes of buffer differentially into d_encoded and returns
+ * the bytes written. The frame is padded with zero bits to whole symbols
+ * and bytes, so that the next frame starts on a symbol boundary.
+ */
+size_t
+framer_impl::encode_differential(size_t len)
+{
+    const int bps = psk::bits_per_symbol(d_mod);
+    const size_t group = (bps == 3) ? 3 : 1;
+    size_t out_len = (len + group - 1) / group * group;
+
+    std::fill_n(d_encoded, out_len, 0);
+    for(size_t i = 0; i < out_len * 8; i += bps){
+        uint8_t l = 0;
+        for(int j = 0; j < bps; j++){
+            size_t k = i + j;
+            uint8_t b = (k < len * 8) ? (buffer[k / 8] >> (7 - k % 8)) & 1 : 0;
+            l = (l << 1) | b;
+        }
+        d_phase += psk::phase(d_mod, l);
+        l = psk::label(d_mod, d_phase);
+        for(int j = 0; j < bps; j++){
+            size_t k = i + j;
+            d_encoded[k / 8] |= ((l >> (bps - 1 - j)) & 1) << (7 - k % 8);
+        }
+    }
+    d_phase &= (1 << bps) - 1;
+    return out_len;
 }
 
 void
@@ -85,29 +135,32 @@ framer_impl::construct(pmt::pmt_t m)
     const uint8_t *bytes_in = pmt::u8vector_elements(bytes, pdu_len);
     size_t bufferElement = bufferStart;
 
-    /*
-     * TODO: Do processing
-     */
-
     if(pdu_len > max_size) 
         return;
 
-    buffer[bufferElement] = (pdu_len >> 8);
-    buffer[bufferElement + 1] = pdu_len;
-    bufferElement += 2;
+    /* The sync word of the virtual channel asked for, the first one if none */
+    size_t vcid = 0;
+    if(pmt::is_dict(meta)){
+        vcid = pmt::to_uint64(pmt::dict_ref(meta, pmt::mp("vcid"), pmt::from_uint64(0)));
+    }
+    if(vcid >= d_nsync_words)
+        return;
+    std::copy_n(&d_sync_word[vcid * d_sync_len], d_sync_len, buffer + d_preamble_len);
+
+    frame_header::encode(buffer + bufferElement, d_header, pdu_len, d_golay);
+    bufferElement += frame_header::size(d_header);
 
     for(int i = 0; i < pdu_len; i++){
         buffer[bufferElement] = bytes_in[i];
         bufferElement++;
     }
 
-    /*
-     * FIXME: This just copies the input to the output. It is just for testing
-     * purposes.
-     * NOTE: Obey the pair scheme that GNU Radio uses otherwise following
-     * blocks will not work. In your case if you do not have any associated
-     * metadata, place just pmt::PMT_NIL on the first element of the pair
-     */
+    /* The frame goes out as a (metadata, bytes) pair with no metadata */
+    if(d_differential){
+        bufferElement = encode_differential(bufferElement);
+        message_port_pub(pmt::mp("frame"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(d_encoded, bufferElement)));
+        return;
+    }
     message_port_pub(pmt::mp("frame"), pmt::cons(pmt::PMT_NIL, pmt::make_blob(buffer, bufferElement)));
 }
 
@@ -116,7 +169,8 @@ framer_impl::construct(pmt::pmt_t m)
  */
 framer_impl::~framer_impl()
 {
-    delete buffer;
+    delete[] buffer;
+    delete[] d_encoded;
 }
 
 } /* namespace tutorial */
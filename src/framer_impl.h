@@ -22,6 +22,8 @@
 #define INCLUDED_TUTORIAL_FRAMER_IMPL_H
 
 #include <tutorial/framer.h>
+#include "psk.h"
+#include "frame_header.h"
 
 namespace gr {
 namespace tutorial {
@@ -32,14 +34,33 @@ private:
     construct(pmt::pmt_t m);
     uint8_t d_preamble; 
     size_t d_preamble_len;
+    /* Sync words, one per virtual channel, of d_sync_len bytes each */
     const std::vector<uint8_t> d_sync_word;
+    const size_t d_nsync_words;
+    size_t d_sync_len;
     uint8_t* buffer;
     size_t bufferStart;
     size_t max_size;
+    const int d_mod;
+    /*
+     * Differential mapping: every symbol carries its label as a phase
+     * change from the symbol before it, across frames
+     */
+    const bool d_differential;
+    uint8_t *d_encoded;
+    int d_phase;
+    /* Header format, see frame_header.h */
+    const int d_header;
+    golay24 d_golay;
+
+    size_t
+    encode_differential(size_t len);
 
 public:
     framer_impl(uint8_t preamble, size_t preamble_len,
-                const std::vector<uint8_t> &sync_word);
+                const std::vector<uint8_t> &sync_word, int mod,
+                bool differential, int header_format,
+                size_t nsync_words);
     ~framer_impl();
 
 
@@ -0,0 +1,474 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "golay24.h"
+#include "bit_utils.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+
+namespace gr {
+namespace tutorial {
+
+const uint16_t golay24::P[12] = {
+    0x8ed, /* 1 0 0 0 1 1 1 0 1 1 0 1 */
+    0x1db, /* 0 0 0 1 1 1 0 1 1 0 1 1 */
+    0x3b5, /* 0 0 1 1 1 0 1 1 0 1 0 1 */
+    0x769, /* 0 1 1 1 0 1 1 0 1 0 0 1 */
+    0xed1, /* 1 1 1 0 1 1 0 1 0 0 0 1 */
+    0xda3, /* 1 1 0 1 1 0 1 0 0 0 1 1 */
+    0xb47, /* 1 0 1 1 0 1 0 0 0 1 1 1 */
+    0x68f, /* 0 1 1 0 1 0 0 0 1 1 1 1 */
+    0xd1d, /* 1 1 0 1 0 0 0 1 1 1 0 1 */
+    0xa3b, /* 1 0 1 0 0 0 1 1 1 0 1 1 */
+    0x477, /* 0 1 0 0 0 1 1 1 0 1 1 1 */
+    0xffe  /* 1 1 1 1 1 1 1 1 1 1 1 0 */
+};
+
+golay24::golay24() : d_bitsliced(false)
+{
+    /* Data bit i (MSB first) adds row i of P to the parity */
+    for (uint32_t data = 0; data < 4096; data++) {
+        uint32_t parity = 0;
+        for (int i = 0; i < 12; i++) {
+            if (data & (1 << (11 - i))) {
+                parity ^= P[i];
+            }
+        }
+        d_encode_table[data] = (parity << 12) | data;
+    }
+
+    for (uint32_t s = 0; s < 4096; s++) {
+        d_decode_table[s] = coset_leader(s);
+    }
+}
+
+/*
+ * Bitsliced decoding. Lane l of plane b holds bit b of the l-th codeword,
+ * so one word-wide operation works on 64 (uint64_t) or 256 (32-byte
+ * vector) codewords at once.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TUTORIAL_GOLAY24_AVX2
+typedef uint64_t lanes256_t __attribute__((vector_size(32)));
+#endif
+
+/*
+ * Saturating counter over the 12 planes of x ^ flip: ge[k] gets the lanes
+ * whose weight is at least k + 1.
+ */
+template <typename V>
+static inline __attribute__((always_inline)) void
+weight_ge(const V x[12], uint16_t flip, V ge[4])
+{
+    const V mask[2] = {V(), ~V()};
+    ge[0] = ge[1] = ge[2] = ge[3] = V();
+    for (int q = 0; q < 12; q++) {
+        V v = x[q] ^ mask[(flip >> q) & 1];
+        ge[3] |= ge[2] & v;
+        ge[2] |= ge[1] & v;
+        ge[1] |= ge[0] & v;
+        ge[0] |= v;
+    }
+}
+
+/*
+ * The same decision steps as coset_leader(), evaluated for all lanes in
+ * parallel. Lanes are resolved by the first step that matches. Corrects
+ * the 24 planes of r in place and sets fail to the uncorrectable lanes.
+ */
+template <typename V>
+static inline __attribute__((always_inline)) void
+correct_planes(V r[24], V &fail)
+{
+    V s[12];
+    V sp[12];
+    V e[24];
+    V ge[4];
+    V done;
+    V m;
+
+    for (int q = 0; q < 12; q++) {
+        s[q] = r[12 + q];
+        for (int i = 0; i < 12; i++) {
+            if ((golay24::P[i] >> q) & 1) {
+                s[q] ^= r[11 - i];
+            }
+        }
+    }
+    for (int b = 0; b < 24; b++) {
+        e[b] = V();
+    }
+
+    /* if w(s) <= 3 then set e = (s, 0) */
+    weight_ge(s, 0, ge);
+    done = ~ge[3];
+    for (int q = 0; q < 12; q++) {
+        e[12 + q] = done & s[q];
+    }
+
+    /* if w(s + pi) <= 2 for some pi then set e = (s + pi, u(i)) */
+    for (int i = 0; i < 12; i++) {
+        weight_ge(s, golay24::P[i], ge);
+        m = ~ge[2] & ~done;
+        for (int q = 0; q < 12; q++) {
+            e[12 + q] |= m & (((golay24::P[i] >> q) & 1) ? ~s[q] : s[q]);
+        }
+        e[11 - i] |= m;
+        done |= m;
+    }
+
+    /* if w(s*P) = 2 or w(s*P) = 3 then set e = (0, s*P) */
+    for (int q = 0; q < 12; q++) {
+        sp[q] = V();
+        for (int i = 0; i < 12; i++) {
+            if ((golay24::P[i] >> q) & 1) {
+                sp[q] ^= s[11 - i];
+            }
+        }
+    }
+    weight_ge(sp, 0, ge);
+    m = ge[1] & ~ge[3] & ~done;
+    for (int q = 0; q < 12; q++) {
+        e[q] |= m & sp[q];
+    }
+    done |= m;
+
+    /* if w(s*P + pi) = 2 for some pi then set e = (u(i), s*P + pi) */
+    for (int i = 0; i < 12; i++) {
+        weight_ge(sp, golay24::P[i], ge);
+        m = ge[1] & ~ge[2] & ~done;
+        for (int q = 0; q < 12; q++) {
+            e[q] |= m & (((golay24::P[i] >> q) & 1) ? ~sp[q] : sp[q]);
+        }
+        e[23 - i] |= m;
+        done |= m;
+    }
+
+    for (int b = 0; b < 24; b++) {
+        r[b] ^= e[b];
+    }
+    fail = ~done;
+}
+
+static void
+correct64(uint32_t *words)
+{
+    uint64_t a[64];
+
+    for (int l = 0; l < 64; l++) {
+        a[l] = words[l] & 0xffffff;
+    }
+    bit_utils::transpose64(a);
+    correct_planes<uint64_t>(a, a[31]);
+    bit_utils::transpose64(a);
+    for (int l = 0; l < 64; l++) {
+        words[l] = a[l];
+    }
+}
+
+#ifdef TUTORIAL_GOLAY24_AVX2
+__attribute__((target("avx2"))) static void
+correct256(uint32_t *words)
+{
+    uint64_t a[4][64];
+    lanes256_t r[24];
+
+    for (int k = 0; k < 4; k++) {
+        for (int l = 0; l < 64; l++) {
+            a[k][l] = words[64 * k + l] & 0xffffff;
+        }
+        bit_utils::transpose64(a[k]);
+    }
+    for (int b = 0; b < 24; b++) {
+        r[b] = lanes256_t{a[0][b], a[1][b], a[2][b], a[3][b]};
+    }
+    lanes256_t fail;
+    correct_planes<lanes256_t>(r, fail);
+    for (int k = 0; k < 4; k++) {
+        for (int b = 0; b < 24; b++) {
+            a[k][b] = r[b][k];
+        }
+        a[k][31] = fail[k];
+        bit_utils::transpose64(a[k]);
+        for (int l = 0; l < 64; l++) {
+            words[64 * k + l] = a[k][l];
+        }
+    }
+}
+#endif
+
+static int
+weight(uint32_t v)
+{
+    return std::bitset<32>(v).count();
+}
+
+/*
+ * Runs the step-by-step syndrome decoding algorithm once for the given
+ * syndrome. The data half of a pattern is the 12 LSBs, the parity half the
+ * next 12 bits, matching the codeword layout.
+ */
+uint32_t
+golay24::coset_leader(uint16_t s) const
+{
+    /* if w(s) <= 3 then set e = (s, 0) */
+    if (weight(s) <= 3) {
+        return s << 12;
+    }
+
+    /* if w(s + pi) <= 2 for some pi then set e = (s + pi, u(i)) */
+    for (int i = 0; i < 12; i++) {
+        if (weight(s ^ P[i]) <= 2) {
+            return ((s ^ P[i]) << 12) | (1 << (11 - i));
+        }
+    }
+
+    /* if w(s*P) = 2 or w(s*P) = 3 then set e = (0, s*P) */
+    uint16_t sp = d_encode_table[s] >> 12;
+    if (weight(sp) == 2 || weight(sp) == 3) {
+        return sp;
+    }
+
+    /* if w(s*P + pi) = 2 for some pi then set e = (u(i), s*P + pi) */
+    for (int i = 0; i < 12; i++) {
+        if (weight(sp ^ P[i]) == 2) {
+            return (1 << (23 - i)) | (sp ^ P[i]);
+        }
+    }
+
+    return UNCORRECTABLE;
+}
+
+void
+golay24::encode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t data = (in[0] << 16) | (in[1] << 8) | in[2];
+        uint32_t c0 = d_encode_table[data >> 12];
+        uint32_t c1 = d_encode_table[data & 0xfff];
+
+        out[0] = c0 >> 16;
+        out[1] = c0 >> 8;
+        out[2] = c0;
+        out[3] = c1 >> 16;
+        out[4] = c1 >> 8;
+        out[5] = c1;
+        in += 3;
+        out += 6;
+    }
+}
+
+size_t
+golay24::decode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t failures = 0;
+    uint16_t d0;
+    uint16_t d1;
+
+    if (d_bitsliced) {
+        return decode_bitsliced(out, in, len);
+    }
+
+    for (size_t i = 0; i < len; i += 6) {
+        uint32_t c0 = (in[0] << 16) | (in[1] << 8) | in[2];
+        uint32_t c1 = (in[3] << 16) | (in[4] << 8) | in[5];
+
+        failures += !decode(c0, d0);
+        failures += !decode(c1, d1);
+
+        out[0] = d0 >> 4;
+        out[1] = (d0 << 4) | (d1 >> 8);
+        out[2] = d1;
+        in += 6;
+        out += 3;
+    }
+    return failures;
+}
+
+size_t
+golay24::decode_soft(uint8_t *out, const int8_t *llr, size_t n) const
+{
+    size_t failures = 0;
+    int16_t v[24];
+    uint32_t d[2];
+
+    for (size_t i = 0; i < n; i += 48) {
+        for (int k = 0; k < 2; k++) {
+            std::copy(llr, llr + 24, v);
+            d[k] = chase(v);
+            if (d[k] & UNCORRECTABLE) {
+                d[k] = 0;
+                failures++;
+            }
+            d[k] &= 0xfff;
+            llr += 24;
+        }
+
+        out[0] = d[0] >> 4;
+        out[1] = (d[0] << 4) | (d[1] >> 8);
+        out[2] = d[1];
+        out += 3;
+    }
+    return failures;
+}
+
+size_t
+golay24::decode_bitsliced(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t failures = 0;
+    uint32_t words[256];
+
+    while (len > 0) {
+        size_t n = std::min<size_t>(len / 3, 256);
+
+        for (size_t i = 0; i < n; i++) {
+            words[i] = (in[3 * i] << 16) | (in[3 * i + 1] << 8) | in[3 * i + 2];
+        }
+        correct_bitsliced(words, n);
+        for (size_t i = 0; i < n; i++) {
+            if (words[i] & UNCORRECTABLE) {
+                words[i] = 0;
+                failures++;
+            }
+            words[i] &= 0xfff;
+        }
+        for (size_t i = 0; i < n; i += 2) {
+            out[0] = words[i] >> 4;
+            out[1] = (words[i] << 4) | (words[i + 1] >> 8);
+            out[2] = words[i + 1];
+            out += 3;
+        }
+        in += 3 * n;
+        len -= 3 * n;
+    }
+    return failures;
+}
+
+void
+golay24::correct_bitsliced(uint32_t *words, size_t n) const
+{
+#ifdef TUTORIAL_GOLAY24_AVX2
+    if (bit_utils::have_avx2()) {
+        for (; n >= 256; n -= 256, words += 256) {
+            correct256(words);
+        }
+    }
+#endif
+    for (; n >= 64; n -= 64, words += 64) {
+        correct64(words);
+    }
+    correct(words, n);
+}
+
+uint32_t
+golay24::chase(const int16_t llr[24], int16_t *ext, int16_t beta) const
+{
+    /* Hard decisions and reliabilities, indexed by codeword bit */
+    uint32_t hard = 0;
+    int32_t rel[24];
+    for (int i = 0; i < 24; i++) {
+        hard |= (uint32_t)(llr[i] < 0) << (23 - i);
+        rel[23 - i] = std::abs((int32_t)llr[i]);
+    }
+
+    /* The least reliable bits, by insertion into a short sorted list */
+    int pos[CHASE_BITS];
+    int npos = 0;
+    for (int b = 0; b < 24; b++) {
+        int k = std::min(npos, CHASE_BITS - 1);
+        if (npos == CHASE_BITS && rel[b] >= rel[pos[k]]) {
+            continue;
+        }
+        for (; k > 0 && rel[b] < rel[pos[k - 1]]; k--) {
+            pos[k] = pos[k - 1];
+        }
+        pos[k] = b;
+        npos = std::min(npos + 1, (int) CHASE_BITS);
+    }
+
+    uint32_t cand[1 << CHASE_BITS];
+    int32_t metric[1 << CHASE_BITS];
+    int ncand = 0;
+    int best = -1;
+    for (int p = 0; p < (1 << CHASE_BITS); p++) {
+        uint32_t word = hard;
+        for (int k = 0; k < CHASE_BITS; k++) {
+            word ^= (uint32_t)((p >> k) & 1) << pos[k];
+        }
+        uint32_t e = d_decode_table[syndrome(word)];
+        if (e & UNCORRECTABLE) {
+            continue;
+        }
+        cand[ncand] = word ^ e;
+        metric[ncand] = 0;
+        for (uint32_t d = cand[ncand] ^ hard; d; d &= d - 1) {
+            metric[ncand] += rel[__builtin_ctz(d)];
+        }
+        if (best < 0 || metric[ncand] < metric[best]) {
+            best = ncand;
+        }
+        ncand++;
+    }
+    if (best < 0) {
+        if (ext) {
+            std::fill(ext, ext + 24, 0);
+        }
+        return hard | UNCORRECTABLE;
+    }
+    if (!ext) {
+        return cand[best];
+    }
+
+    /* Closest competitor on every bit */
+    int32_t gap[24];
+    std::fill(gap, gap + 24, -1);
+    for (int c = 0; c < ncand; c++) {
+        for (uint32_t d = cand[c] ^ cand[best]; d; d &= d - 1) {
+            int b = __builtin_ctz(d);
+            int32_t g = metric[c] - metric[best];
+            gap[b] = (gap[b] < 0) ? g : std::min(gap[b], g);
+        }
+    }
+    for (int i = 0; i < 24; i++) {
+        int b = 23 - i;
+        int32_t sign = ((cand[best] >> b) & 1) ? -1 : 1;
+        int32_t w = (gap[b] < 0) ? sign * beta : sign * gap[b] - llr[i];
+        ext[i] = std::min(std::max(w, (int32_t) -127), (int32_t) 127);
+    }
+    return cand[best];
+}
+
+void
+golay24::correct(uint32_t *words, size_t n) const
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t e = d_decode_table[syndrome(words[i])];
+        words[i] = (e & UNCORRECTABLE) ? (words[i] | UNCORRECTABLE) : (words[i] ^ e);
+    }
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
@@ -0,0 +1,158 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_GOLAY24_H
+#define INCLUDED_TUTORIAL_GOLAY24_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Extended Golay(24,12) code working on packed data.
+ *
+ * A codeword is held in the 24 LSBs of a uint32_t. Following the
+ * G = [P | I] generator, the 12 parity bits occupy bits 23..12 and the 12
+ * data bits occupy bits 11..0, so the codeword is transmitted MSB first.
+ */
+class golay24 {
+public:
+    /* Flag set in an error pattern whose syndrome cannot be corrected */
+    static const uint32_t UNCORRECTABLE = 0x80000000;
+
+    golay24();
+
+    uint32_t
+    encode(uint16_t data) const
+    {
+        return d_encode_table[data & 0xfff];
+    }
+
+    /*
+     * Encodes len bytes into 2 * len bytes. Every 3 input bytes hold two
+     * 12-bit data words, which become 6 output bytes. len must be a
+     * multiple of 3.
+     */
+    void encode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /* 12-bit syndrome of a received 24-bit word */
+    uint16_t
+    syndrome(uint32_t word) const
+    {
+        return ((word >> 12) ^ (d_encode_table[word & 0xfff] >> 12)) & 0xfff;
+    }
+
+    /*
+     * 24-bit error pattern for the given syndrome, or UNCORRECTABLE when
+     * the syndrome does not belong to a correctable coset.
+     */
+    uint32_t
+    error_pattern(uint16_t syndrome) const
+    {
+        return d_decode_table[syndrome & 0xfff];
+    }
+
+    /*
+     * Decodes a received 24-bit word into its 12 data bits. Returns false
+     * and sets data to 0 if the word is not correctable.
+     */
+    bool
+    decode(uint32_t word, uint16_t &data) const
+    {
+        uint32_t e = d_decode_table[syndrome(word)];
+        data = (e & UNCORRECTABLE) ? 0 : (word ^ e) & 0xfff;
+        return !(e & UNCORRECTABLE);
+    }
+
+    /*
+     * Decodes len bytes into len / 2 bytes. Every 6 input bytes hold two
+     * codewords, which become 3 output bytes. len must be a multiple of 6.
+     * Uncorrectable codewords produce 12 zero bits.
+     *
+     * Returns the number of uncorrectable codewords.
+     */
+    size_t decode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Same as decode(), but from n received LLRs in transmission order, a
+     * positive LLR meaning a 0 bit, decoded with Chase-II. n must be a
+     * multiple of 48 and gives n / 16 output bytes.
+     */
+    size_t decode_soft(uint8_t *out, const int8_t *llr, size_t n) const;
+
+    /*
+     * Corrects n received words in place. A correctable word is replaced
+     * by its codeword, an uncorrectable one keeps its bits and gets the
+     * UNCORRECTABLE flag set.
+     */
+    void correct(uint32_t *words, size_t n) const;
+
+    /*
+     * Same as correct(), but batches of 64 words (256 on AVX2 capable
+     * CPUs) are transposed into bit planes and decoded together with
+     * word-wide logic. Leftover words go through the syndrome table. It
+     * needs no lookup tables, so its speed does not depend on the cache.
+     */
+    void correct_bitsliced(uint32_t *words, size_t n) const;
+
+    /* Number of least reliable bits Chase-II tries flipping */
+    static const int CHASE_BITS = 4;
+
+    /*
+     * Chase-II decoding of 24 LLRs in transmission order, llr[i] belonging
+     * to bit 23 - i and a positive LLR meaning a 0 bit. Every combination
+     * of the CHASE_BITS least reliable hard decisions is flipped and the
+     * test pattern goes through the syndrome table. Returns the candidate
+     * codeword with the smallest LLR mass against it, or UNCORRECTABLE if
+     * no test pattern decodes.
+     *
+     * If ext is given it receives the extrinsic LLRs of the decision. For
+     * a bit that some other candidate disagrees on, this is the metric gap
+     * to the best such candidate minus the input LLR. For a bit no
+     * candidate disagrees on it is beta.
+     */
+    uint32_t chase(const int16_t llr[24], int16_t *ext = NULL,
+                   int16_t beta = 0) const;
+
+    /* Makes decode() use the bitsliced decoder instead of the table */
+    void
+    set_bitsliced(bool bitsliced)
+    {
+        d_bitsliced = bitsliced;
+    }
+
+    /* Row i of the P matrix, MSB first */
+    static const uint16_t P[12];
+
+private:
+    bool d_bitsliced;
+    uint32_t d_encode_table[4096];
+    uint32_t d_decode_table[4096];
+
+    uint32_t coset_leader(uint16_t s) const;
+    size_t decode_bitsliced(uint8_t *out, const uint8_t *in, size_t len) const;
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_GOLAY24_H */
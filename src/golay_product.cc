@@ -0,0 +1,250 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "golay_product.h"
+#include "bit_utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Inside the decoders a block is held as 32 words, word r being the
+ * codeword of row 23 - r in its 24 LSBs. The data is then the 12 LSBs of
+ * words 11..0, and a transpose gives the columns in the same layout.
+ */
+static void
+load(uint32_t m[32], const uint8_t *in)
+{
+    for (size_t x = 0; x < 24; x++) {
+        m[23 - x] = (in[3 * x] << 16) | (in[3 * x + 1] << 8) | in[3 * x + 2];
+    }
+    std::fill(m + 24, m + 32, 0);
+}
+
+static void
+store_data(uint8_t *out, const uint32_t m[32])
+{
+    for (size_t i = 0; i < 12; i += 2) {
+        uint32_t d0 = m[11 - i] & 0xfff;
+        uint32_t d1 = m[10 - i] & 0xfff;
+        out[0] = d0 >> 4;
+        out[1] = (d0 << 4) | (d1 >> 8);
+        out[2] = d1;
+        out += 3;
+    }
+}
+
+golay_product::golay_product(size_t max_iterations)
+    : d_max_iterations(max_iterations)
+{
+}
+
+size_t
+golay_product::encoded_len(size_t len) const
+{
+    return (len + 2 + DATA_BYTES - 1) / DATA_BYTES * BLOCK_BYTES;
+}
+
+void
+golay_product::encode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t nblocks = encoded_len(len) / BLOCK_BYTES;
+    uint8_t data[DATA_BYTES];
+    uint32_t m[32];
+
+    for (size_t b = 0; b < nblocks; b++) {
+        /* The length prefix, then the PDU, then zeros */
+        for (size_t i = 0; i < DATA_BYTES; i++) {
+            size_t k = b * DATA_BYTES + i;
+            data[i] = (k == 0) ? len >> 8 : (k == 1) ? len & 0xff
+                      : (k - 2 < len) ? in[k - 2] : 0;
+        }
+
+        /* Data rows first, then all the columns */
+        std::fill(m, m + 32, 0);
+        for (size_t i = 0; i < 12; i += 2) {
+            const uint8_t *d = data + 3 * i / 2;
+            m[11 - i] = d_golay.encode((d[0] << 4) | (d[1] >> 4));
+            m[10 - i] = d_golay.encode(((d[1] & 0xf) << 8) | d[2]);
+        }
+        bit_utils::transpose32(m);
+        for (size_t c = 0; c < 24; c++) {
+            m[c] = d_golay.encode(m[c]);
+        }
+        bit_utils::transpose32(m);
+
+        for (size_t x = 0; x < 24; x++) {
+            out[3 * x] = m[23 - x] >> 16;
+            out[3 * x + 1] = m[23 - x] >> 8;
+            out[3 * x + 2] = m[23 - x];
+        }
+        out += BLOCK_BYTES;
+    }
+}
+
+void
+golay_product::decode(uint8_t *info, const uint8_t *in, size_t nblocks,
+                      size_t &iterations, size_t &failed) const
+{
+    uint32_t m[GROUP][32];
+    uint32_t batch[GROUP * 24];
+    size_t active[GROUP];
+    bool dirty[GROUP];
+
+    iterations = 0;
+    failed = 0;
+    for (size_t b0 = 0; b0 < nblocks; b0 += GROUP) {
+        size_t n = std::min((size_t) GROUP, nblocks - b0);
+        size_t nactive = n;
+        for (size_t b = 0; b < n; b++) {
+            load(m[b], in + (b0 + b) * BLOCK_BYTES);
+            active[b] = b;
+        }
+
+        for (size_t it = 0; it < d_max_iterations && nactive; it++) {
+            iterations += nactive;
+
+            /*
+             * A row pass, then a column pass. A block is done when neither
+             * pass meets an uncorrectable word and the column pass changes
+             * nothing, as the rows were codewords after the row pass.
+             */
+            for (int pass = 0; pass < 2; pass++) {
+                for (size_t a = 0; a < nactive; a++) {
+                    memcpy(batch + 24 * a, m[active[a]], 24 * sizeof(uint32_t));
+                    dirty[a] = pass ? dirty[a] : false;
+                }
+                /*
+                 * The passes are batched, not parallelized. Two table
+                 * lookups per word are cheaper than the bitsliced decoder
+                 * (2-3 times slower here) or AVX2 gathers (no faster), and
+                 * a PDU is too small to split across threads.
+                 */
+                d_golay.correct(batch, 24 * nactive);
+                for (size_t a = 0; a < nactive; a++) {
+                    uint32_t *words = m[active[a]];
+                    for (size_t r = 0; r < 24; r++) {
+                        uint32_t w = batch[24 * a + r];
+                        if (w & golay24::UNCORRECTABLE) {
+                            dirty[a] = true;
+                            continue;
+                        }
+                        dirty[a] |= pass && w != words[r];
+                        words[r] = w;
+                    }
+                    bit_utils::transpose32(words);
+                }
+            }
+
+            size_t k = 0;
+            for (size_t a = 0; a < nactive; a++) {
+                if (dirty[a]) {
+                    active[k++] = active[a];
+                }
+            }
+            nactive = k;
+        }
+        failed += nactive;
+
+        for (size_t b = 0; b < n; b++) {
+            store_data(info + (b0 + b) * DATA_BYTES, m[b]);
+        }
+    }
+}
+
+/*
+ * Soft input of one pass: the channel LLRs plus half the extrinsic LLRs
+ * of the other pass.
+ */
+static inline int16_t
+pass_input(int8_t ch, int16_t ext)
+{
+    return ch + ext / 2;
+}
+
+void
+golay_product::decode_soft(uint8_t *info, const int8_t *llr, size_t nblocks,
+                           size_t &iterations, size_t &failed) const
+{
+    /* Extrinsic LLRs of the row and the column passes, by (row, bit) */
+    int16_t wr[24][24];
+    int16_t wc[24][24];
+    int16_t v[24];
+    int16_t e[24];
+    uint32_t m[32];
+
+    iterations = 0;
+    failed = 0;
+    for (size_t b = 0; b < nblocks; b++) {
+        const int8_t (*ch)[24] = (const int8_t (*)[24])(llr + b * BLOCK_BITS);
+        bool done = false;
+
+        memset(wc, 0, sizeof(wc));
+        for (size_t it = 0; it < d_max_iterations && !done; it++) {
+            iterations++;
+
+            /* Later iterations trust the extrinsic values more */
+            int16_t beta = std::min<int16_t>(16 * (it + 1), 64);
+
+            for (size_t x = 0; x < 24; x++) {
+                for (size_t y = 0; y < 24; y++) {
+                    v[y] = pass_input(ch[x][y], wc[x][y]);
+                }
+                d_golay.chase(v, wr[x], beta);
+            }
+
+            /*
+             * The column decisions give the block decision, in the
+             * transposed layout: word 23 - y holds column y.
+             */
+            done = true;
+            for (size_t y = 0; y < 24; y++) {
+                for (size_t x = 0; x < 24; x++) {
+                    v[x] = pass_input(ch[x][y], wr[x][y]);
+                }
+                uint32_t c = d_golay.chase(v, e, beta);
+                done &= !(c & golay24::UNCORRECTABLE);
+                m[23 - y] = c & 0xffffff;
+                for (size_t x = 0; x < 24; x++) {
+                    wc[x][y] = e[x];
+                }
+            }
+            std::fill(m + 24, m + 32, 0);
+            bit_utils::transpose32(m);
+
+            for (size_t r = 0; r < 24; r++) {
+                done &= d_golay.syndrome(m[r]) == 0;
+            }
+        }
+        failed += !done;
+
+        store_data(info + b * DATA_BYTES, m);
+    }
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
@@ -0,0 +1,86 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_GOLAY_PRODUCT_H
+#define INCLUDED_TUTORIAL_GOLAY_PRODUCT_H
+
+#include "golay24.h"
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Product code with the extended Golay(24,12) code on both the rows and
+ * the columns of a 24 x 24 bit block, carrying 144 data bits.
+ *
+ * A block is sent row by row, 3 bytes per row. Every row is a Golay
+ * codeword sent MSB first, and so is every column read from the first
+ * row to the last. The last 12 rows carry the data in their last 12 bits,
+ * 12 data bits per row, so the 12 parity rows go first.
+ *
+ * As for the LDPC type, a PDU is prefixed with its length as a 16-bit big
+ * endian word and zero padded to a whole number of 18-byte blocks.
+ *
+ * The hard decoder alternates row and column passes until a column pass
+ * leaves every row and column a codeword. All rows (or columns) of up to
+ * GROUP blocks are independent, and they go through the syndrome table as
+ * one batch of lookups that do not wait for each other. That batch runs
+ * on one thread, without SIMD: see decode(). The soft decoder
+ * runs Chase-II on every row and column instead, passing the extrinsic
+ * LLRs of one pass on to the next.
+ */
+class golay_product {
+public:
+    static const size_t DATA_BYTES = 18;
+    static const size_t BLOCK_BYTES = 72;
+    static const size_t BLOCK_BITS = 576;
+    /* The longest PDU the 16-bit length prefix can describe */
+    static const size_t MAX_LEN = 65535;
+
+    golay_product(size_t max_iterations = 8);
+
+    size_t encoded_len(size_t len) const;
+
+    void encode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Hard decodes nblocks coded blocks into DATA_BYTES bytes each, length
+     * prefix included. iterations gets the iterations run over all blocks
+     * and failed the blocks that did not converge.
+     */
+    void decode(uint8_t *info, const uint8_t *in, size_t nblocks,
+                size_t &iterations, size_t &failed) const;
+
+    /* The same from BLOCK_BITS LLRs per block, a positive LLR meaning 0 */
+    void decode_soft(uint8_t *info, const int8_t *llr, size_t nblocks,
+                     size_t &iterations, size_t &failed) const;
+
+private:
+    /* Blocks decoded together by the hard decoder */
+    static const size_t GROUP = 32;
+
+    const size_t d_max_iterations;
+    golay24 d_golay;
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_GOLAY_PRODUCT_H */
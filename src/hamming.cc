@@ -0,0 +1,162 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hamming.h"
+
+#include <bitset>
+
+namespace gr {
+namespace tutorial {
+
+static uint8_t
+codeword_74(uint8_t d)
+{
+    uint8_t d0 = d & 1;
+    uint8_t d1 = (d >> 1) & 1;
+    uint8_t d2 = (d >> 2) & 1;
+    uint8_t d3 = (d >> 3) & 1;
+
+    return (d << 3) | ((d0 ^ d1 ^ d3) << 2) | ((d0 ^ d2 ^ d3) << 1)
+           | (d1 ^ d2 ^ d3);
+}
+
+static uint8_t
+codeword_84(uint8_t d)
+{
+    uint8_t c = codeword_74(d);
+    return (c << 1) | (std::bitset<8>(c).count() & 1);
+}
+
+hamming::hamming()
+{
+    /* Both nibbles of a byte at once, high nibble first */
+    for (int b = 0; b < 256; b++) {
+        d_encode_74[b] = (codeword_74(b >> 4) << 7) | codeword_74(b & 0xf);
+        d_encode_84[b] = (codeword_84(b >> 4) << 8) | codeword_84(b & 0xf);
+    }
+
+    /*
+     * Minimum distance decoding of every possible received word. A (8,4)
+     * word at distance 2 from its closest codewords is a detected double
+     * error, and its data bits are passed through.
+     */
+    for (int w = 0; w < 128; w++) {
+        uint8_t best = 0;
+        size_t best_dist = 8;
+        for (uint8_t d = 0; d < 16; d++) {
+            size_t dist = std::bitset<8>(w ^ codeword_74(d)).count();
+            if (dist < best_dist) {
+                best = d;
+                best_dist = dist;
+            }
+        }
+        d_decode_74[w] = best | (best_dist ? CORRECTED : 0);
+    }
+    for (int w = 0; w < 256; w++) {
+        uint8_t best = 0;
+        size_t best_dist = 8;
+        for (uint8_t d = 0; d < 16; d++) {
+            size_t dist = std::bitset<8>(w ^ codeword_84(d)).count();
+            if (dist < best_dist) {
+                best = d;
+                best_dist = dist;
+            }
+        }
+        if (best_dist <= 1) {
+            d_decode_84[w] = best | (best_dist ? CORRECTED : 0);
+        } else {
+            d_decode_84[w] = (w >> 4) | DETECTED;
+        }
+    }
+}
+
+void
+hamming::encode_74(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    uint32_t acc = 0;
+    int nbits = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        acc = (acc << 14) | d_encode_74[in[i]];
+        nbits += 14;
+        while (nbits >= 8) {
+            nbits -= 8;
+            *out++ = acc >> nbits;
+        }
+    }
+    if (nbits) {
+        *out = acc << (8 - nbits);
+    }
+}
+
+void
+hamming::encode_84(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = d_encode_84[in[i]] >> 8;
+        out[2 * i + 1] = d_encode_84[in[i]];
+    }
+}
+
+size_t
+hamming::decode_74(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t corrected = 0;
+    size_t out_len = decoded_len_74(len);
+    uint32_t acc = 0;
+    int nbits = 0;
+
+    for (size_t i = 0; i < out_len; i++) {
+        while (nbits < 14) {
+            acc = (acc << 8) | *in++;
+            nbits += 8;
+        }
+        nbits -= 14;
+        uint8_t hi = d_decode_74[(acc >> (nbits + 7)) & 0x7f];
+        uint8_t lo = d_decode_74[(acc >> nbits) & 0x7f];
+        corrected += ((hi & CORRECTED) != 0) + ((lo & CORRECTED) != 0);
+        out[i] = ((hi & 0xf) << 4) | (lo & 0xf);
+    }
+    return corrected;
+}
+
+size_t
+hamming::decode_84(uint8_t *out, const uint8_t *in, size_t len,
+                   size_t &detected) const
+{
+    size_t corrected = 0;
+
+    detected = 0;
+    for (size_t i = 0; i < len / 2; i++) {
+        uint8_t hi = d_decode_84[in[2 * i]];
+        uint8_t lo = d_decode_84[in[2 * i + 1]];
+        corrected += ((hi & CORRECTED) != 0) + ((lo & CORRECTED) != 0);
+        detected += ((hi & DETECTED) != 0) + ((lo & DETECTED) != 0);
+        out[i] = ((hi & 0xf) << 4) | (lo & 0xf);
+    }
+    return corrected;
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
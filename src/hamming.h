@@ -0,0 +1,84 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_HAMMING_H
+#define INCLUDED_TUTORIAL_HAMMING_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Hamming(7,4) and its extended SECDED form Hamming(8,4), working on
+ * packed data with lookup tables.
+ *
+ * A codeword carries the data nibble MSB first followed by the parity
+ * bits p0 = d0 ^ d1 ^ d3, p1 = d0 ^ d2 ^ d3 and p2 = d1 ^ d2 ^ d3, where
+ * d3 is the MSB of the nibble. The (8,4) codeword appends an overall
+ * parity bit. Every input byte becomes 14 bits of (7,4) codewords, packed
+ * back to back, or two bytes of (8,4) codewords.
+ */
+class hamming {
+public:
+    hamming();
+
+    /* Number of bytes the (7,4) code produces for len data bytes */
+    static size_t
+    encoded_len_74(size_t len)
+    {
+        return (14 * len + 7) / 8;
+    }
+
+    /* Number of data bytes carried by len bytes of (7,4) codewords */
+    static size_t
+    decoded_len_74(size_t len)
+    {
+        return (8 * len / 7) / 2;
+    }
+
+    void encode_74(uint8_t *out, const uint8_t *in, size_t len) const;
+    void encode_84(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Decodes len coded bytes. Returns the number of corrected codewords.
+     * The (8,4) decoder also counts the codewords with a detected double
+     * error in detected. Their data bits are passed through uncorrected.
+     */
+    size_t decode_74(uint8_t *out, const uint8_t *in, size_t len) const;
+    size_t decode_84(uint8_t *out, const uint8_t *in, size_t len,
+                     size_t &detected) const;
+
+private:
+    /* Decoder table entries: data nibble plus status flags */
+    static const uint8_t CORRECTED = 0x10;
+    static const uint8_t DETECTED = 0x20;
+
+    uint16_t d_encode_74[256];
+    uint16_t d_encode_84[256];
+    uint8_t d_decode_74[128];
+    uint8_t d_decode_84[256];
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_HAMMING_H */
@@ -22,6 +22,7 @@
 #define INCLUDED_TUTORIAL_INTERLEAVER_IMPL_H
 
 #include <tutorial/interleaver.h>
+#include "bit_utils.h"
 
 namespace gr {
 namespace tutorial {
@@ -29,7 +30,8 @@ namespace tutorial {
 class interleaver_impl : public interleaver {
 private:
     const size_t d_block_size;
-    uint8_t** interleave_table;
+    /* Plans of the PDU lengths seen last, few in practice */
+    bit_utils::transpose_cache d_plans;
 
     void
     interleave(pmt::pmt_t m);
@@ -0,0 +1,399 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ldpc.h"
+#include "bit_utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TUTORIAL_LDPC_AVX2
+#endif
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * 802.11n rate 1/2, n = 648 base matrix. Entry s is the 27 x 27 identity
+ * cyclically shifted by s, -1 an all zero block. Columns 12..23 are the
+ * parity part: a weight 3 column followed by a dual diagonal.
+ */
+static const int8_t BASE[ldpc::ROWS][ldpc::COLS] = {
+    { 0, -1, -1, -1,  0,  0, -1, -1,  0, -1, -1,  0,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {22,  0, -1, -1, 17, -1,  0,  0, 12, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    { 6, -1,  0, -1, 10, -1, -1, -1, 24, -1,  0, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1},
+    { 2, -1, -1,  0, 20, -1, -1, -1, 25,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1},
+    {23, -1, -1, -1,  3, -1, -1, -1,  0, -1,  9, 11, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1},
+    {24, -1, 23,  1, 17, -1,  3, -1, 10, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1},
+    {25, -1, -1, -1,  8, -1, -1, -1,  7, 18, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1},
+    {13, 24, -1, -1,  0, -1,  8, -1,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1},
+    { 7, 20, -1, 16, 22, 10, -1, -1, 23, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1},
+    {11, -1, -1, -1, 19, -1, -1, -1, 13, -1,  3, 17, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1},
+    {25, -1,  8, -1, 23, 18, -1, 14,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0},
+    { 3, -1, -1, -1, 16, -1, -1,  2, 25,  5, -1, -1,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0}
+};
+
+static const uint32_t MASK = (1u << ldpc::Z) - 1;
+
+/* Min-sum messages and posteriors stay within +-127 */
+static const int LLR_MAX = 127;
+
+/*
+ * Bit k of a block word is bit k of the block. The circulant with shift s
+ * maps block bit (k + s) mod Z to check k.
+ */
+static uint32_t
+rot(uint32_t x, size_t s)
+{
+    return s ? ((x >> s) | (x << (ldpc::Z - s))) & MASK : x;
+}
+
+/* Block words hold their first bit in bit 0, the byte stream MSB first */
+static uint32_t
+reverse27(uint32_t v)
+{
+    v = ((v >> 1) & 0x55555555) | ((v & 0x55555555) << 1);
+    v = ((v >> 2) & 0x33333333) | ((v & 0x33333333) << 2);
+    v = ((v >> 4) & 0x0f0f0f0f) | ((v & 0x0f0f0f0f) << 4);
+    return __builtin_bswap32(v) >> 5;
+}
+
+/* Byte b of the length prefixed, zero padded information stream */
+static uint8_t
+stream_byte(const uint8_t *in, size_t len, size_t b)
+{
+    if (b < 2) {
+        return b ? len : len >> 8;
+    }
+    return b - 2 < len ? in[b - 2] : 0;
+}
+
+static int8_t
+clamp(int v)
+{
+    return std::max(-LLR_MAX, std::min(LLR_MAX, v));
+}
+
+/*
+ * A posterior block lives in a slot of ldpc::SLOT bytes. Its Z values are
+ * repeated from ORIGIN - Z to ORIGIN + 2Z, so the window at ORIGIN + s is
+ * the circulant shifted by s, lane k holding the bit of check k.
+ */
+static const size_t ORIGIN = 32;
+
+static void
+layer_generic(int8_t post[][ldpc::SLOT], int8_t msg[][32],
+              const ldpc::edge *e, size_t deg)
+{
+    int8_t t[ldpc::MAX_DEGREE][ldpc::Z];
+
+    for (size_t k = 0; k < ldpc::Z; k++) {
+        int min1 = LLR_MAX;
+        int min2 = LLR_MAX;
+        size_t idx = 0;
+        int sgn = 0;
+
+        for (size_t j = 0; j < deg; j++) {
+            t[j][k] = clamp(post[e[j].col][ORIGIN + e[j].shift + k] - msg[j][k]);
+            int a = std::abs(t[j][k]);
+            min2 = std::min(min2, std::max(min1, a));
+            if (a < min1) {
+                idx = j;
+                min1 = a;
+            }
+            sgn ^= t[j][k];
+        }
+
+        min1 -= min1 >> 2;
+        min2 -= min2 >> 2;
+        for (size_t j = 0; j < deg; j++) {
+            int r = (j == idx) ? min2 : min1;
+            r = ((sgn ^ t[j][k]) < 0) ? -r : r;
+            msg[j][k] = r;
+            post[e[j].col][ORIGIN + e[j].shift + k] = clamp(t[j][k] + r);
+        }
+    }
+
+    /* Restore the repeats around the rewritten window */
+    for (size_t j = 0; j < deg; j++) {
+        int8_t *p = post[e[j].col] + ORIGIN + e[j].shift;
+        memcpy(p - ldpc::Z, p, ldpc::Z);
+        memcpy(p + ldpc::Z, p, ldpc::Z);
+    }
+}
+
+#ifdef TUTORIAL_LDPC_AVX2
+/*
+ * The same layer, all 27 checks in one register. The lanes past Z carry
+ * junk that never reaches a valid lane.
+ */
+__attribute__((target("avx2"))) static void
+layer_avx2(int8_t post[][ldpc::SLOT], int8_t msg[][32], const ldpc::edge *e,
+           size_t deg)
+{
+    const __m256i floor = _mm256_set1_epi8(-LLR_MAX);
+    const __m256i one = _mm256_set1_epi8(1);
+    __m256i t[ldpc::MAX_DEGREE];
+    __m256i min1 = _mm256_set1_epi8(LLR_MAX);
+    __m256i min2 = min1;
+    __m256i idx = _mm256_setzero_si256();
+    __m256i sgn = _mm256_setzero_si256();
+
+    for (size_t j = 0; j < deg; j++) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(post[e[j].col] + ORIGIN + e[j].shift));
+        __m256i m = _mm256_load_si256((const __m256i *)msg[j]);
+        t[j] = _mm256_max_epi8(_mm256_subs_epi8(p, m), floor);
+
+        __m256i a = _mm256_abs_epi8(t[j]);
+        min2 = _mm256_min_epu8(min2, _mm256_max_epu8(min1, a));
+        idx = _mm256_blendv_epi8(idx, _mm256_set1_epi8(j), _mm256_cmpgt_epi8(min1, a));
+        min1 = _mm256_min_epu8(min1, a);
+        sgn = _mm256_xor_si256(sgn, t[j]);
+    }
+
+    const __m256i low6 = _mm256_set1_epi8(0x3f);
+    min1 = _mm256_sub_epi8(min1, _mm256_and_si256(_mm256_srli_epi16(min1, 2), low6));
+    min2 = _mm256_sub_epi8(min2, _mm256_and_si256(_mm256_srli_epi16(min2, 2), low6));
+
+    for (size_t j = 0; j < deg; j++) {
+        __m256i second = _mm256_cmpeq_epi8(idx, _mm256_set1_epi8(j));
+        __m256i mag = _mm256_blendv_epi8(min1, min2, second);
+        __m256i r = _mm256_sign_epi8(mag, _mm256_or_si256(_mm256_xor_si256(sgn, t[j]), one));
+        _mm256_store_si256((__m256i *)msg[j], r);
+
+        /*
+         * Three overlapping stores rebuild the repeats, each one
+         * overwriting the junk lanes of the one before.
+         */
+        __m256i p = _mm256_max_epi8(_mm256_adds_epi8(t[j], r), floor);
+        int8_t *w = post[e[j].col] + ORIGIN + e[j].shift;
+        _mm256_storeu_si256((__m256i *)(w - ldpc::Z), p);
+        _mm256_storeu_si256((__m256i *)w, p);
+        _mm256_storeu_si256((__m256i *)(w + ldpc::Z), p);
+    }
+}
+
+__attribute__((target("avx2"))) static void
+hard_decisions_avx2(int8_t post[][ldpc::SLOT], uint32_t words[ldpc::COLS])
+{
+    for (size_t j = 0; j < ldpc::COLS; j++) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(post[j] + ORIGIN));
+        words[j] = _mm256_movemask_epi8(p) & MASK;
+    }
+}
+#endif
+
+static void
+hard_decisions(int8_t post[][ldpc::SLOT], uint32_t words[ldpc::COLS])
+{
+#ifdef TUTORIAL_LDPC_AVX2
+    if (bit_utils::have_avx2()) {
+        hard_decisions_avx2(post, words);
+        return;
+    }
+#endif
+    for (size_t j = 0; j < ldpc::COLS; j++) {
+        words[j] = 0;
+        for (size_t k = 0; k < ldpc::Z; k++) {
+            words[j] |= (uint32_t)(post[j][ORIGIN + k] < 0) << k;
+        }
+    }
+}
+
+ldpc::ldpc(size_t max_iterations) : d_max_iterations(max_iterations)
+{
+    size_t n = 0;
+    for (size_t r = 0; r < ROWS; r++) {
+        d_row_start[r] = n;
+        for (size_t c = 0; c < COLS; c++) {
+            if (BASE[r][c] >= 0) {
+                d_edges[n].col = c;
+                d_edges[n].shift = BASE[r][c];
+                n++;
+            }
+        }
+    }
+    d_row_start[ROWS] = n;
+}
+
+size_t
+ldpc::encoded_len(size_t len) const
+{
+    return ((8 * (len + 2) + K - 1) / K) * CODEWORD_BYTES;
+}
+
+/*
+ * The dual diagonal parity part makes encoding a few block XORs. With
+ * lambda_i the information part of check row i, the weight 3 column
+ * cancels out of the sum of all rows, giving p0 = sum lambda_i. Row i then
+ * yields p(i + 1) from p(i) and p0.
+ */
+void
+ldpc::encode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t ncw = encoded_len(len) / CODEWORD_BYTES;
+
+    for (size_t cw = 0; cw < ncw; cw++) {
+        uint32_t w[COLS];
+        uint32_t lambda[ROWS];
+        uint32_t p0 = 0;
+
+        for (size_t j = 0; j < K / Z; j++) {
+            size_t pos = cw * K + j * Z;
+            uint64_t v = 0;
+            for (size_t b = 0; b < 5; b++) {
+                v = (v << 8) | stream_byte(in, len, pos / 8 + b);
+            }
+            w[j] = reverse27((v >> (40 - pos % 8 - Z)) & MASK);
+        }
+
+        for (size_t r = 0; r < ROWS; r++) {
+            lambda[r] = 0;
+            for (size_t i = d_row_start[r]; i < d_row_start[r + 1]; i++) {
+                if (d_edges[i].col < K / Z) {
+                    lambda[r] ^= rot(w[d_edges[i].col], d_edges[i].shift);
+                }
+            }
+            p0 ^= lambda[r];
+        }
+        w[K / Z] = p0;
+        for (size_t r = 0; r + 1 < ROWS; r++) {
+            uint32_t p = lambda[r];
+            if (BASE[r][K / Z] >= 0) {
+                p ^= rot(p0, BASE[r][K / Z]);
+            }
+            if (r > 0) {
+                p ^= w[K / Z + r];
+            }
+            w[K / Z + r + 1] = p;
+        }
+
+        uint64_t acc = 0;
+        size_t nbits = 0;
+        for (size_t j = 0; j < COLS; j++) {
+            acc = (acc << Z) | reverse27(w[j]);
+            nbits += Z;
+            while (nbits >= 8) {
+                nbits -= 8;
+                *out++ = acc >> nbits;
+            }
+        }
+    }
+}
+
+bool
+ldpc::check(const uint32_t words[COLS]) const
+{
+    for (size_t r = 0; r < ROWS; r++) {
+        uint32_t s = 0;
+        for (size_t i = d_row_start[r]; i < d_row_start[r + 1]; i++) {
+            s ^= rot(words[d_edges[i].col], d_edges[i].shift);
+        }
+        if (s) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Runs layered iterations until the hard decisions in words form a
+ * codeword or the iteration limit is reached. Returns the iterations run.
+ */
+size_t
+ldpc::decode_codeword(int8_t post[][SLOT], int8_t msg[][32],
+                      uint32_t words[COLS], bool &ok) const
+{
+    hard_decisions(post, words);
+    ok = check(words);
+    for (size_t it = 1; !ok && it <= d_max_iterations; it++) {
+        for (size_t r = 0; r < ROWS; r++) {
+            const edge *e = d_edges + d_row_start[r];
+            size_t deg = d_row_start[r + 1] - d_row_start[r];
+#ifdef TUTORIAL_LDPC_AVX2
+            if (bit_utils::have_avx2()) {
+                layer_avx2(post, msg + d_row_start[r], e, deg);
+                continue;
+            }
+#endif
+            layer_generic(post, msg + d_row_start[r], e, deg);
+        }
+        hard_decisions(post, words);
+        ok = check(words);
+        if (ok) {
+            return it;
+        }
+    }
+    return ok ? 0 : d_max_iterations;
+}
+
+void
+ldpc::decode(uint8_t *info, const int8_t *llr, size_t ncw,
+             size_t &iterations, size_t &failed) const
+{
+    alignas(32) int8_t post[COLS][SLOT];
+    alignas(32) int8_t msg[ROWS * MAX_DEGREE][32];
+    uint32_t words[COLS];
+    uint64_t acc = 0;
+    size_t nbits = 0;
+
+    iterations = 0;
+    failed = 0;
+    memset(post, 0, sizeof(post));
+    for (size_t cw = 0; cw < ncw; cw++) {
+        for (size_t j = 0; j < COLS; j++) {
+            int8_t *p = post[j] + ORIGIN;
+            for (size_t k = 0; k < Z; k++) {
+                p[k] = clamp(llr[j * Z + k]);
+            }
+            memcpy(p - Z, p, Z);
+            memcpy(p + Z, p, Z);
+        }
+        memset(msg, 0, sizeof(msg));
+        llr += N;
+
+        bool ok;
+        iterations += decode_codeword(post, msg, words, ok);
+        failed += !ok;
+
+        /* Information blocks, 324 bits per codeword back to back */
+        for (size_t j = 0; j < K / Z; j++) {
+            acc = (acc << Z) | reverse27(words[j]);
+            nbits += Z;
+            while (nbits >= 8) {
+                nbits -= 8;
+                *info++ = acc >> nbits;
+            }
+        }
+    }
+    if (nbits) {
+        *info = acc << (8 - nbits);
+    }
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
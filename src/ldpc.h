@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_LDPC_H
+#define INCLUDED_TUTORIAL_LDPC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Quasi-cyclic LDPC code with the IEEE 802.11n rate 1/2, n = 648 parity
+ * check matrix (12 x 24 circulants of size 27).
+ *
+ * A PDU is prefixed with its length as a 16-bit big endian word and the
+ * result is zero padded to a whole number of 324-bit information blocks.
+ * Each block is encoded systematically into 648 bits (81 bytes): the 324
+ * information bits followed by the 324 parity bits, MSB first.
+ *
+ * The decoder is a layered normalized min-sum decoder on int8 messages.
+ * One circulant row is one layer and all 27 of its checks are updated at
+ * once, with AVX2 where available. It stops as soon as the hard decisions
+ * satisfy all the checks.
+ */
+class ldpc {
+public:
+    static const size_t Z = 27;
+    static const size_t N = 648;
+    static const size_t K = 324;
+    static const size_t CODEWORD_BYTES = N / 8;
+    /* The longest PDU the 16-bit length prefix can describe */
+    static const size_t MAX_LEN = 65535;
+
+    ldpc(size_t max_iterations = 20);
+
+    size_t encoded_len(size_t len) const;
+
+    /* Bytes needed to hold the information bits of ncw codewords */
+    static size_t
+    info_len(size_t ncw)
+    {
+        return (ncw * K + 7) / 8;
+    }
+
+    void encode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Decodes ncw codewords given as N LLRs each, a positive LLR meaning
+     * a 0 bit. The information bits, length prefix included, are packed
+     * into info. iterations gets the iterations run over all codewords and
+     * failed the codewords that did not converge.
+     */
+    void decode(uint8_t *info, const int8_t *llr, size_t ncw,
+                size_t &iterations, size_t &failed) const;
+
+    static const size_t ROWS = 12;
+    static const size_t COLS = 24;
+    static const size_t MAX_DEGREE = 8;
+    /* Bytes reserved per posterior block in the decoder */
+    static const size_t SLOT = 128;
+
+    /* A non-empty circulant: its block column and cyclic shift */
+    struct edge {
+        uint8_t col;
+        uint8_t shift;
+    };
+
+private:
+    const size_t d_max_iterations;
+    /* The non-empty circulants, row by row */
+    edge d_edges[ROWS * MAX_DEGREE];
+    size_t d_row_start[ROWS + 1];
+
+    bool check(const uint32_t words[COLS]) const;
+    size_t decode_codeword(int8_t post[][SLOT], int8_t msg[][32],
+                           uint32_t words[COLS], bool &ok) const;
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_LDPC_H */
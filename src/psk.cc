@@ -0,0 +1,57 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "psk.h"
+
+namespace gr {
+namespace tutorial {
+namespace psk {
+
+/* Natural binary labels in phase order */
+static const uint8_t labels[3][8] = {
+    {0, 1},
+    {0, 1, 2, 3},
+    {0, 1, 2, 3, 4, 5, 6, 7}
+};
+
+uint8_t
+label(int mod, int p)
+{
+    return labels[mod][p & ((1 << bits_per_symbol(mod)) - 1)];
+}
+
+int
+phase(int mod, uint8_t l)
+{
+    for(int p = 0; p < (1 << bits_per_symbol(mod)); p++){
+        if(labels[mod][p] == l){
+            return p;
+        }
+    }
+    return 0;
+}
+
+} // namespace psk
+} /* namespace tutorial */
+} /* namespace gr */
@@ -0,0 +1,55 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_PSK_H
+#define INCLUDED_TUTORIAL_PSK_H
+
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Bit labels of the BPSK (mod 0), QPSK (mod 1) and 8PSK (mod 2)
+ * constellations, shared by the framer and the frame synchronizer. Labels
+ * are sent MSB first, and rotating the constellation by k steps of
+ * 360 / M degrees turns the label of the point at phase p into the label
+ * of the point at phase p + k.
+ */
+namespace psk {
+
+inline int
+bits_per_symbol(int mod)
+{
+    return mod + 1;
+}
+
+/* The label of the point at phase p, in steps of 360 / M degrees */
+uint8_t label(int mod, int p);
+
+/* The phase of the point with label l */
+int phase(int mod, uint8_t l);
+
+} // namespace psk
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_PSK_H */
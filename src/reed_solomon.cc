@@ -0,0 +1,303 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "reed_solomon.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace gr {
+namespace tutorial {
+
+reed_solomon::reed_solomon(size_t block_len) : d_block_len(block_len)
+{
+    if (block_len == 0 || block_len > K) {
+        throw std::invalid_argument("reed_solomon: Invalid block length");
+    }
+
+    /* Antilog table runs twice around the field, so sums of logs need no mod */
+    uint32_t x = 1;
+    for (size_t i = 0; i < N; i++) {
+        d_exp[i] = d_exp[i + N] = x;
+        d_log[x] = i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11d;
+        }
+    }
+    d_log[0] = 0;
+
+    /* g(x) = (x + alpha^0)(x + alpha^1) ... (x + alpha^31), g[k] of x^k */
+    uint8_t g[PARITY + 1] = {1};
+    for (size_t i = 0; i < PARITY; i++) {
+        for (size_t k = i + 1; k > 0; k--) {
+            g[k] = g[k - 1] ^ mul(g[k], d_exp[i]);
+        }
+        g[0] = mul(g[0], d_exp[i]);
+    }
+
+    /* parity[0] holds the x^31 coefficient of the remainder */
+    for (int fb = 0; fb < 256; fb++) {
+        for (size_t j = 0; j < PARITY; j++) {
+            d_feedback[fb][j] = mul(fb, g[PARITY - 1 - j]);
+        }
+    }
+}
+
+size_t
+reed_solomon::encoded_len(size_t len) const
+{
+    size_t rest = len % d_block_len;
+    return (len / d_block_len) * (d_block_len + PARITY)
+           + (rest ? rest + PARITY : 0);
+}
+
+size_t
+reed_solomon::decoded_len(size_t len) const
+{
+    size_t rest = len % (d_block_len + PARITY);
+    if (rest && rest <= PARITY) {
+        return 0;
+    }
+    return (len / (d_block_len + PARITY)) * d_block_len
+           + (rest ? rest - PARITY : 0);
+}
+
+/*
+ * Remainder of in(x) * x^32 divided by g(x). The division register is a
+ * 32-byte shift register, and every input byte shifts it by one and adds
+ * the precomputed multiple of g(x) for the feedback byte.
+ */
+void
+reed_solomon::remainder(uint8_t parity[PARITY], const uint8_t *in,
+                        size_t len) const
+{
+#ifdef __SSE2__
+    __m128i p0 = _mm_setzero_si128();
+    __m128i p1 = _mm_setzero_si128();
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t fb = in[i] ^ _mm_cvtsi128_si32(p0);
+        p0 = _mm_or_si128(_mm_srli_si128(p0, 1), _mm_slli_si128(p1, 15));
+        p1 = _mm_srli_si128(p1, 1);
+        p0 = _mm_xor_si128(p0, _mm_loadu_si128((const __m128i *)d_feedback[fb]));
+        p1 = _mm_xor_si128(p1, _mm_loadu_si128((const __m128i *)(d_feedback[fb] + 16)));
+    }
+    _mm_storeu_si128((__m128i *)parity, p0);
+    _mm_storeu_si128((__m128i *)(parity + 16), p1);
+#else
+    std::fill(parity, parity + PARITY, 0);
+    for (size_t i = 0; i < len; i++) {
+        uint8_t fb = in[i] ^ parity[0];
+        for (size_t j = 0; j < PARITY - 1; j++) {
+            parity[j] = parity[j + 1] ^ d_feedback[fb][j];
+        }
+        parity[PARITY - 1] = d_feedback[fb][PARITY - 1];
+    }
+#endif
+}
+
+void
+reed_solomon::encode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    for (size_t i = 0; i < len; i += d_block_len) {
+        size_t k = std::min(d_block_len, len - i);
+        memcpy(out, in + i, k);
+        remainder(out + k, in + i, k);
+        out += k + PARITY;
+    }
+}
+
+int
+reed_solomon::decode_block(uint8_t *block, size_t n) const
+{
+    uint8_t rem[PARITY];
+    uint8_t s[PARITY];
+
+    /* A codeword leaves no remainder, which is the common case */
+    remainder(rem, block, n - PARITY);
+    uint8_t any = 0;
+    for (size_t j = 0; j < PARITY; j++) {
+        rem[j] ^= block[n - PARITY + j];
+        any |= rem[j];
+    }
+    if (!any) {
+        return 0;
+    }
+
+    /* S_i = r(alpha^i) = rem(alpha^i), as g(alpha^i) = 0 */
+    std::fill(s, s + PARITY, 0);
+    for (size_t j = 0; j < PARITY; j++) {
+        if (rem[j]) {
+            size_t lg = d_log[rem[j]];
+            size_t step = PARITY - 1 - j;
+            for (size_t i = 0; i < PARITY; i++) {
+                s[i] ^= d_exp[lg];
+                lg += step;
+                lg -= (lg >= N) ? N : 0;
+            }
+        }
+    }
+
+    /* Berlekamp-Massey for the error locator lambda */
+    uint8_t lambda[PARITY + 1] = {1};
+    uint8_t b[PARITY + 1] = {1};
+    uint8_t t[PARITY + 1];
+    size_t l = 0;
+    size_t shift = 1;
+    uint8_t bd = 1;
+
+    for (size_t r = 0; r < PARITY; r++) {
+        uint8_t d = s[r];
+        for (size_t i = 1; i <= l; i++) {
+            d ^= mul(lambda[i], s[r - i]);
+        }
+        if (!d) {
+            shift++;
+            continue;
+        }
+
+        /* lambda -= d / bd * x^shift * b */
+        uint8_t coef = d_exp[d_log[d] + N - d_log[bd]];
+        std::copy(lambda, lambda + PARITY + 1, t);
+        for (size_t i = 0; i + shift <= PARITY; i++) {
+            lambda[i + shift] ^= mul(coef, b[i]);
+        }
+        if (2 * l <= r) {
+            l = r + 1 - l;
+            std::copy(t, t + PARITY + 1, b);
+            bd = d;
+            shift = 1;
+        } else {
+            shift++;
+        }
+    }
+    if (l > PARITY / 2) {
+        return -1;
+    }
+
+    /*
+     * Chien search over the positions the (shortened) block has. Term i of
+     * lambda(alpha^-e) is kept as a log, and moving to the next byte
+     * (e - 1) multiplies it by alpha^i.
+     */
+    size_t pos[PARITY / 2];
+    size_t nroots = 0;
+    size_t term[PARITY / 2 + 1];
+    size_t nterms = 0;
+    size_t power[PARITY / 2 + 1];
+    for (size_t i = 1; i <= l; i++) {
+        if (lambda[i]) {
+            term[nterms] = (d_log[lambda[i]] + i * (N - (n - 1))) % N;
+            power[nterms++] = i;
+        }
+    }
+    for (size_t p = 0; p < n; p++) {
+        uint8_t v = lambda[0];
+        for (size_t i = 0; i < nterms; i++) {
+            v ^= d_exp[term[i]];
+            term[i] += power[i];
+            term[i] -= (term[i] >= N) ? N : 0;
+        }
+        if (!v) {
+            if (nroots == l) {
+                return -1;
+            }
+            pos[nroots++] = p;
+        }
+    }
+    if (nroots != l) {
+        return -1;
+    }
+
+    /* Forney: omega = s * lambda mod x^l, e = X omega(1/X) / lambda'(1/X) */
+    uint8_t omega[PARITY / 2];
+    for (size_t k = 0; k < l; k++) {
+        omega[k] = 0;
+        for (size_t i = 0; i <= k; i++) {
+            omega[k] ^= mul(lambda[i], s[k - i]);
+        }
+    }
+    uint8_t mag[PARITY / 2];
+    for (size_t j = 0; j < nroots; j++) {
+        size_t e = n - 1 - pos[j];
+        size_t inv = (N - e) % N;
+        uint8_t num = 0;
+        uint8_t den = 0;
+        for (size_t k = 0; k < l; k++) {
+            if (omega[k]) {
+                num ^= d_exp[(d_log[omega[k]] + k * inv) % N];
+            }
+        }
+        for (size_t i = 1; i <= l; i += 2) {
+            if (lambda[i]) {
+                den ^= d_exp[(d_log[lambda[i]] + (i - 1) * inv) % N];
+            }
+        }
+        if (!den) {
+            return -1;
+        }
+        mag[j] = num ? d_exp[(d_log[num] + e + N - d_log[den]) % N] : 0;
+    }
+    for (size_t j = 0; j < nroots; j++) {
+        block[pos[j]] ^= mag[j];
+    }
+    return nroots;
+}
+
+size_t
+reed_solomon::decode(uint8_t *out, const uint8_t *in, size_t len,
+                     size_t &failed) const
+{
+    uint8_t block[N];
+    size_t corrected = 0;
+
+    failed = 0;
+    for (size_t i = 0; i < len; i += d_block_len + PARITY) {
+        size_t n = std::min(d_block_len + PARITY, len - i);
+        if (n <= PARITY) {
+            break;
+        }
+        size_t k = n - PARITY;
+        memcpy(block, in + i, n);
+
+        int ret = decode_block(block, n);
+        if (ret < 0) {
+            failed++;
+        } else {
+            corrected += ret;
+        }
+        memcpy(out, block, k);
+        out += k;
+    }
+    return corrected;
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
@@ -0,0 +1,91 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_REED_SOLOMON_H
+#define INCLUDED_TUTORIAL_REED_SOLOMON_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Reed-Solomon (255,223) code over GF(256), field polynomial 0x11d, with
+ * the generator roots alpha^0 .. alpha^31. It corrects up to 16 byte
+ * errors per block.
+ *
+ * Data is cut into blocks of block_len bytes, each followed by its 32
+ * parity bytes. A block_len below 223 gives a shortened code, and the last
+ * block of a PDU is shortened further to the bytes that are left, so any
+ * length can be encoded without padding.
+ */
+class reed_solomon {
+public:
+    static const size_t N = 255;
+    static const size_t K = 223;
+    static const size_t PARITY = N - K;
+
+    reed_solomon(size_t block_len = K);
+
+    size_t encoded_len(size_t len) const;
+
+    /*
+     * Number of data bytes carried by len coded bytes, or 0 if len cannot
+     * be a sequence of coded blocks.
+     */
+    size_t decoded_len(size_t len) const;
+
+    void encode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Decodes len coded bytes into decoded_len(len) bytes. Returns the
+     * number of corrected bytes. The blocks that have too many errors are
+     * counted in failed and their data is passed through unchanged.
+     */
+    size_t decode(uint8_t *out, const uint8_t *in, size_t len,
+                  size_t &failed) const;
+
+    /*
+     * Corrects a coded block of n bytes in place. Returns the number of
+     * corrected bytes, or -1 if the block cannot be corrected.
+     */
+    int decode_block(uint8_t *block, size_t n) const;
+
+private:
+    const size_t d_block_len;
+    uint8_t d_exp[2 * N];
+    uint8_t d_log[256];
+    /* Parity register update for every feedback byte */
+    uint8_t d_feedback[256][PARITY];
+
+    uint8_t
+    mul(uint8_t a, uint8_t b) const
+    {
+        return (a && b) ? d_exp[d_log[a] + d_log[b]] : 0;
+    }
+
+    void remainder(uint8_t parity[PARITY], const uint8_t *in, size_t len) const;
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_REED_SOLOMON_H */
@@ -0,0 +1,148 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "repetition.h"
+#include "bit_utils.h"
+
+#include <bitset>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TUTORIAL_REPETITION_BMI2
+#endif
+
+namespace gr {
+namespace tutorial {
+
+#ifdef TUTORIAL_REPETITION_BMI2
+/*
+ * 24 input bytes are three 64-bit words holding 64 triplets. Bit r of
+ * every triplet is gathered with pext into its own 64-bit word, most
+ * significant first, and the majority is then taken on whole words.
+ */
+static const uint64_t despread_mask[3][3] = {
+    {0x9249249249249249ULL, 0x4924924924924924ULL, 0x2492492492492492ULL},
+    {0x2492492492492492ULL, 0x9249249249249249ULL, 0x4924924924924924ULL},
+    {0x4924924924924924ULL, 0x2492492492492492ULL, 0x9249249249249249ULL}
+};
+
+/* popcount of each mask */
+static const int despread_shift[3][3] = {
+    {22, 21, 21},
+    {21, 22, 21},
+    {21, 21, 22}
+};
+
+__attribute__((target("bmi2"))) static void
+decode_bmi2(uint8_t *out, const uint8_t *in, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; i++) {
+        uint64_t w[3];
+        uint64_t t[3] = {0, 0, 0};
+
+        memcpy(w, in, sizeof(w));
+        for (int k = 0; k < 3; k++) {
+            w[k] = __builtin_bswap64(w[k]);
+            for (int r = 0; r < 3; r++) {
+                t[r] = (t[r] << despread_shift[k][r])
+                       | _pext_u64(w[k], despread_mask[k][r]);
+            }
+        }
+
+        uint64_t maj = __builtin_bswap64((t[0] & t[1]) | (t[0] & t[2]) | (t[1] & t[2]));
+        memcpy(out, &maj, sizeof(maj));
+        in += 24;
+        out += 8;
+    }
+}
+#endif
+
+repetition::repetition()
+{
+    /* Bit j of the input byte goes to stream positions 3j .. 3j + 2 */
+    for (int b = 0; b < 256; b++) {
+        d_encode_table[b] = 0;
+        for (int j = 0; j < 8; j++) {
+            if ((b >> j) & 1) {
+                d_encode_table[b] |= 0x7u << (21 - 3 * j);
+            }
+        }
+    }
+
+    for (int w = 0; w < 4096; w++) {
+        d_majority_table[w] = 0;
+        for (int t = 0; t < 4; t++) {
+            size_t votes = std::bitset<3>(w >> (9 - 3 * t)).count();
+            d_majority_table[w] |= (votes >= 2) << (3 - t);
+        }
+    }
+}
+
+void
+repetition::encode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    for (size_t i = 0; i < len; i++) {
+        uint32_t c = d_encode_table[in[i]];
+        out[0] = c >> 16;
+        out[1] = c >> 8;
+        out[2] = c;
+        out += 3;
+    }
+}
+
+void
+repetition::decode(uint8_t *out, const uint8_t *in, size_t len) const
+{
+    size_t out_len = len / 3;
+    size_t i = 0;
+
+#ifdef TUTORIAL_REPETITION_BMI2
+    if (bit_utils::have_bmi2()) {
+        decode_bmi2(out, in, out_len / 8);
+        i = out_len - out_len % 8;
+    }
+#endif
+    for (; i < out_len; i++) {
+        uint32_t w = (in[3 * i] << 16) | (in[3 * i + 1] << 8) | in[3 * i + 2];
+        out[i] = (d_majority_table[w >> 12] << 4) | d_majority_table[w & 0xfff];
+    }
+}
+
+void
+repetition::decode_soft(uint8_t *out, const int8_t *llr, size_t n) const
+{
+    for (size_t i = 0; i < n / 24; i++) {
+        uint8_t b = 0;
+        for (size_t j = 0; j < 8; j++) {
+            int sum = llr[0] + llr[1] + llr[2];
+            b = (b << 1) | (sum < 0);
+            llr += 3;
+        }
+        out[i] = b;
+    }
+}
+
+} /* namespace tutorial */
+} /* namespace gr */
@@ -0,0 +1,63 @@
+/* -*- c++ -*- */
+/*
+ * gr-tutorial: Useful blocks for SDR and GNU Radio learning
+ *
+ *  Copyright (C) 2019, 2020 Manolis Surligas <surligas@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDED_TUTORIAL_REPETITION_H
+#define INCLUDED_TUTORIAL_REPETITION_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gr {
+namespace tutorial {
+
+/*
+ * Rate 1/3 repetition code (FEC type 1) on packed data.
+ *
+ * The encoder sends the bits of each input byte LSB first, every bit
+ * three times, so one byte becomes three. The decoder takes the majority
+ * of every three consecutive received bits and packs the results MSB
+ * first, three input bytes giving one output byte.
+ */
+class repetition {
+public:
+    repetition();
+
+    void encode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /* Decodes the first 3 * (len / 3) bytes into len / 3 bytes */
+    void decode(uint8_t *out, const uint8_t *in, size_t len) const;
+
+    /*
+     * Soft decoding of received LLRs, a positive LLR meaning a 0 bit. Each
+     * bit is decided on the sum of its three LLRs. Decodes the first
+     * 24 * (n / 24) LLRs into n / 24 bytes.
+     */
+    void decode_soft(uint8_t *out, const int8_t *llr, size_t n) const;
+
+private:
+    uint32_t d_encode_table[256];
+    /* Majority of 4 triplets (12 bits) into 4 bits */
+    uint8_t d_majority_table[4096];
+};
+
+} // namespace tutorial
+} // namespace gr
+
+#endif /* INCLUDED_TUTORIAL_REPETITION_H */